@@ -0,0 +1,133 @@
+#include "biomemap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "blocks.h"
+#include "random.h"
+
+struct BiomeInfo
+{
+    float temperature;
+    float humidity;
+    BiomeMap::Params params;
+    uint8_t top;
+    uint8_t filler;
+};
+
+// plains keep the heights and decoration rates the terrain had before biomes
+static const BiomeInfo biomes[BiomeMap::COUNT] = {
+    {  0.0f,  0.0f, { 1.0f,  0.0f, 0.006f, 0.13f, 0.02f }, Blocks::Grass, Blocks::Dirt },
+    {  0.4f, -0.4f, { 0.5f, -3.0f, 0.0f,   0.0f,  0.0f  }, Blocks::Sand,  Blocks::Sand },
+    {  0.1f,  0.4f, { 1.2f,  2.0f, 0.03f,  0.2f,  0.04f }, Blocks::Grass, Blocks::Dirt },
+    { -0.4f,  0.0f, { 2.0f, 10.0f, 0.002f, 0.03f, 0.0f  }, Blocks::Stone, Blocks::Stone }
+};
+
+// the cache only grows while the player explores, clearing it now and then is cheaper than tracking use
+static const size_t MAX_CORNERS = 4096;
+
+BiomeMap::BiomeMap(uint64_t seed) :
+    m_temperature(2, 0.002, 1, 2, 0.5, Random::hash(seed, 10, 0, 0)),
+    m_humidity(2, 0.002, 1, 2, 0.5, Random::hash(seed, 11, 0, 0))
+{
+
+}
+
+BiomeMap::Climate BiomeMap::corner(int rx, int rz)
+{
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(rx)) << 32) | static_cast<uint32_t>(rz);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_corners.find(key);
+        if (it != m_corners.end())
+            return it->second;
+    }
+
+    double x = rx * REGION;
+    double z = rz * REGION;
+    float t = static_cast<float>(m_temperature.perlin3(x, z, 0.5));
+    float h = static_cast<float>(m_humidity.perlin3(x, z, 0.5));
+
+    // inverse distance in climate space, close biomes dominate but borders stay smooth
+    Climate climate;
+    float total = 0.0f;
+    for (int b = 0; b < COUNT; b++)
+    {
+        float dt = t - biomes[b].temperature;
+        float dh = h - biomes[b].humidity;
+        float d = dt * dt + dh * dh + 0.01f;
+        climate.weights[b] = 1.0f / (d * d);
+        total += climate.weights[b];
+    }
+    for (int b = 0; b < COUNT; b++)
+        climate.weights[b] /= total;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_corners.size() >= MAX_CORNERS)
+        m_corners.clear();
+    m_corners[key] = climate;
+    return climate;
+}
+
+void BiomeMap::sample(int cx, int cz, Column columns[CHUNK_SIZE * CHUNK_SIZE])
+{
+    // a chunk never straddles a region border, so the same four corners serve every column
+    int x0 = cx * CHUNK_SIZE;
+    int z0 = cz * CHUNK_SIZE;
+    int rx = static_cast<int>(std::floor(static_cast<float>(x0) / REGION));
+    int rz = static_cast<int>(std::floor(static_cast<float>(z0) / REGION));
+    Climate c00 = corner(rx, rz);
+    Climate c01 = corner(rx, rz + 1);
+    Climate c10 = corner(rx + 1, rz);
+    Climate c11 = corner(rx + 1, rz + 1);
+
+    for (int x = 0; x < CHUNK_SIZE; x++)
+    {
+        float fx = static_cast<float>(x0 + x - rx * REGION) / REGION;
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        {
+            float fz = static_cast<float>(z0 + z - rz * REGION) / REGION;
+
+            Column &column = columns[x * CHUNK_SIZE + z];
+            column.params = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+            float best = -1.0f;
+            for (int b = 0; b < COUNT; b++)
+            {
+                float w0 = c00.weights[b] + fz * (c01.weights[b] - c00.weights[b]);
+                float w1 = c10.weights[b] + fz * (c11.weights[b] - c10.weights[b]);
+                float w = w0 + fx * (w1 - w0);
+
+                const Params &p = biomes[b].params;
+                column.params.heightScale += w * p.heightScale;
+                column.params.heightOffset += w * p.heightOffset;
+                column.params.trees += w * p.trees;
+                column.params.grass += w * p.grass;
+                column.params.flowers += w * p.flowers;
+
+                if (w > best)
+                {
+                    best = w;
+                    column.top = biomes[b].top;
+                    column.filler = biomes[b].filler;
+                }
+            }
+        }
+    }
+}
+
+// widens a range of base heights by every biome's scale and offset, blends never leave these extremes
+void BiomeMap::heightRange(float &min, float &max) const
+{
+    float lo = min;
+    float hi = max;
+    for (int b = 0; b < COUNT; b++)
+    {
+        const Params &p = biomes[b].params;
+        for (float h : { lo, hi })
+        {
+            float v = BASE_HEIGHT + (h - BASE_HEIGHT) * p.heightScale + p.heightOffset;
+            min = (std::min)(min, v);
+            max = (std::max)(max, v);
+        }
+    }
+}
\ No newline at end of file
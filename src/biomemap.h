@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include "chunk.h"
+#include "perlin.h"
+
+// Temperature and humidity are sampled once per corner of a 64x64 region and cached, columns blend the
+// biome weights of the four corners around them.
+class BiomeMap
+{
+public:
+    static const int REGION = 64;
+    static const int BASE_HEIGHT = 50;
+
+    enum Biome
+    {
+        Plains,
+        Desert,
+        Forest,
+        Mountains,
+        COUNT
+    };
+
+    struct Params
+    {
+        float heightScale;
+        float heightOffset;
+        float trees;
+        float grass;
+        float flowers;
+    };
+
+    struct Column
+    {
+        Params params;
+        uint8_t top;
+        uint8_t filler;
+    };
+
+    BiomeMap(uint64_t seed);
+
+    void sample(int cx, int cz, Column columns[CHUNK_SIZE * CHUNK_SIZE]);
+    void heightRange(float &min, float &max) const;
+
+private:
+    struct Climate
+    {
+        float weights[COUNT];
+    };
+
+    Climate corner(int rx, int rz);
+
+    Perlin m_temperature;
+    Perlin m_humidity;
+
+    std::mutex m_mutex;
+    std::unordered_map<uint64_t, Climate> m_corners;
+};
\ No newline at end of file
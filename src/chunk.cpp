@@ -1,26 +1,42 @@
 #include "chunk.h"
 
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <ostream>
 #include <queue>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "blocks.h"
-#include "computejob.h"
 #include "timer.h"
 
 const int Chunk::opposites[6] = {
     1, 0, 3, 2, 5, 4
 };
 
-Chunk::Chunk(glm::ivec3 pos) : m_pos(pos), m_dirty(false), m_glDirty(true), m_vertices(),
-m_lightmap{}, m_empty(true), m_blocks{}
+Chunk::Chunk(glm::ivec3 pos) : m_empty(true), m_version(0), m_submitted(0), m_lightDirty(true), m_glDirty(true),
+m_glLightDirty(false), m_computing(false), m_openSky(false), m_sky(false), m_stage(Generated), m_meshId(0), m_pins(0),
+m_evicted(false), m_pos(pos), m_storage(new Storage()), m_fillBlock(Blocks::Air), m_fillLight(0), m_vertices(),
+m_lighting()
 {
     m_worldCenter = glm::vec3(pos.x * 16 + 8, pos.y * 16 + 8, pos.z * 16 + 8);
+    m_lightUpdates.reset = true;
+    std::memset(m_storage.load(), 0, sizeof(Storage));
+}
 
-    m_mesh = std::make_unique<Mesh>(m_vertices, std::vector<int>{3, 2, 1, 1}, true, false);
+// a chunk known to be uniform, it is already lit and has nothing to mesh
+Chunk::Chunk(glm::ivec3 pos, uint8_t fillBlock, uint8_t fillLight) : m_empty(true), m_version(0), m_submitted(0),
+m_lightDirty(false), m_glDirty(false), m_glLightDirty(false), m_computing(false), m_openSky(true), m_sky(false), m_stage(Meshed), m_meshId(0),
+m_pins(0), m_evicted(false), m_pos(pos), m_storage(nullptr), m_fillBlock(fillBlock), m_fillLight(fillLight)
+{
+    m_worldCenter = glm::vec3(pos.x * 16 + 8, pos.y * 16 + 8, pos.z * 16 + 8);
+}
+
+Chunk::~Chunk()
+{
+    delete m_storage.load();
 }
 
 bool Chunk::isEmpty()
@@ -28,65 +44,165 @@ bool Chunk::isEmpty()
     return m_empty;
 }
 
+Chunk::Storage *Chunk::materialize()
+{
+    Storage *storage = new Storage();
+    std::memset(storage->blocks, m_fillBlock, sizeof(storage->blocks));
+    std::memset(storage->lightmap, m_fillLight, sizeof(storage->lightmap));
+    m_storage.store(storage, std::memory_order_release);
+    return storage;
+}
+
 void Chunk::setBlock(int x, int y, int z, uint8_t type)
 {
-    m_blocks[x][y][z] = type;
-    m_dirty = true;
+    Storage *storage = getStorage();
+    if (!storage)
+        storage = materialize();
+
+    storage->blocks[x][y][z] = type;
+    setDirty(true);
+    m_sky = false;
+}
+
+void Chunk::setDirty(bool dirty)
+{
+    if (!dirty)
+    {
+        m_submitted = m_version;
+        return;
+    }
+
+    // later changes before the next job ride along on the same version
+    if (isDirty())
+        return;
+
+    m_version = m_version + 1;
+    m_dirtySince = std::chrono::steady_clock::now();
+}
+
+void Chunk::editBlock(int x, int y, int z, uint8_t type)
+{
+    {
+        std::unique_lock<std::shared_mutex> lock(m_dataMutex);
+        setBlock(x, y, z, type);
+    }
+
+    Lighting::Updates updates;
+    updates.edits.emplace_back(x, y, z);
+    postLight(updates);
 }
 
 uint8_t Chunk::getBlock(int x, int y, int z)
 {
-    return m_blocks[x][y][z];
+    Storage *storage = getStorage();
+    return storage ? storage->blocks[x][y][z] : m_fillBlock;
 }
 
 void Chunk::setSunlight(int x, int y, int z, int val)
 {
-    m_lightmap[x][y][z] = (m_lightmap[x][y][z] & 0xF) | (val << 4);
+    Storage *storage = getStorage();
+    if (!storage)
+    {
+        if (val == getSunlight(x, y, z))
+            return;
+        storage = materialize();
+    }
+
+    uint8_t &light = storage->lightmap[x][y][z];
+    light = (light & 0xF) | (val << 4);
 }
 
 int Chunk::getSunlight(int x, int y, int z)
 {
-    return (m_lightmap[x][y][z] >> 4) & 0xF;
+    Storage *storage = getStorage();
+    return ((storage ? storage->lightmap[x][y][z] : m_fillLight) >> 4) & 0xF;
 }
 
 void Chunk::setLight(int x, int y, int z, int val)
 {
-    m_lightmap[x][y][z] = (m_lightmap[x][y][z] & 0xF0) | val;
+    Storage *storage = getStorage();
+    if (!storage)
+    {
+        if (val == getLight(x, y, z))
+            return;
+        storage = materialize();
+    }
+
+    uint8_t &light = storage->lightmap[x][y][z];
+    light = (light & 0xF0) | val;
 }
 
 int Chunk::getLight(int x, int y, int z)
 {
-    return (m_lightmap[x][y][z]) & 0xF;
+    Storage *storage = getStorage();
+    return (storage ? storage->lightmap[x][y][z] : m_fillLight) & 0xF;
+}
+
+void Chunk::postLight(Lighting::Updates &updates)
+{
+    std::lock_guard<std::mutex> lock(m_lightMutex);
+    m_lightUpdates.merge(updates);
+    m_lightDirty = true;
+}
+
+Lighting::Updates Chunk::takeLightUpdates()
+{
+    std::lock_guard<std::mutex> lock(m_lightMutex);
+    Lighting::Updates updates;
+    std::swap(updates, m_lightUpdates);
+    return updates;
+}
+
+// coords, then the blocks and lightmap when materialized or the fill values when not, then the mesh streams
+void Chunk::write(std::ostream &out)
+{
+    int32_t coords[3] = { m_pos.x, m_pos.y, m_pos.z };
+    out.write(reinterpret_cast<const char*>(coords), sizeof(coords));
+
+    Storage *storage = getStorage();
+    uint8_t fill[3] = { storage != nullptr, m_fillBlock, m_fillLight };
+    out.write(reinterpret_cast<const char*>(fill), sizeof(fill));
+    if (storage)
+        out.write(reinterpret_cast<const char*>(storage), sizeof(Storage));
+
+    uint32_t sizes[2] = { static_cast<uint32_t>(m_vertices.size()), static_cast<uint32_t>(m_lighting.size()) };
+    out.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+    out.write(reinterpret_cast<const char*>(m_vertices.data()), m_vertices.size() * sizeof(float));
+    out.write(reinterpret_cast<const char*>(m_lighting.data()), m_lighting.size() * sizeof(float));
 }
 
 void Chunk::bufferData()
 {
+    if (!m_mesh)
+        m_mesh = std::make_unique<Mesh>(std::vector<std::vector<int>>{ {3, 2}, {1, 1} }, true, false);
+
     if (m_glDirty)
     {
         m_mesh->updateData(m_vertices);
+        m_mesh->updateStream(1, m_lighting);
         m_glDirty = false;
+        m_glLightDirty = false;
+    }
+    else if (m_glLightDirty)
+    {
+        m_mesh->updateStream(1, m_lighting);
+        m_glLightDirty = false;
     }
-}
-
-void Chunk::compute(ChunkMap &chunks)
-{
-    if (!m_dirty)
-        return;
-
-    ComputeJob job(*this, chunks);
-    job.execute();
-    job.transfer();
 }
 
 void Chunk::initBlocks()
 {
+    Storage *storage = getStorage();
+    if (!storage)
+        storage = materialize();
+
     for (int x = 0; x < CHUNK_SIZE; x++)
     {
         for (int y = 0; y < CHUNK_SIZE; y++)
         {
             for (int z = 0; z < CHUNK_SIZE; z++)
             {
-                m_blocks[x][y][z] = Blocks::Air;
+                storage->blocks[x][y][z] = Blocks::Air;
             }
         }
     }
@@ -1,12 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <iosfwd>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <vector>
 
 #include <glm/glm.hpp>
 
+#include "chunkmap.h"
 #include "common.h"
+#include "lighting.h"
 #include "mesh.h"
 
 const int CHUNK_SIZE = 16;
@@ -18,36 +25,113 @@ public:
 
     static const int opposites[6];
 
+    // how far a loaded chunk got, placeholders start out meshed since they have nothing to show
+    enum Stage
+    {
+        Generated,
+        Lit,
+        Meshed
+    };
+
+    struct Face
+    {
+        static const uint8_t Plant = 6;
+
+        uint8_t x, y, z;
+        uint8_t face;
+        bool flip;
+    };
+
     Chunk(glm::ivec3 pos);
+    Chunk(glm::ivec3 pos, uint8_t fillBlock, uint8_t fillLight);
+    ~Chunk();
+
+    Chunk(const Chunk&) = delete;
+    Chunk &operator=(const Chunk&) = delete;
 
-    void compute(ChunkMap &chunks);
     void bufferData();
 
     Mesh &getMesh() const { return *m_mesh; };
-    void setDirty(bool dirty) { m_dirty = dirty; };
-    bool isDirty() { return m_dirty; };
+    // every burst of changes between two jobs gets a new version, clearing hands everything up to it to a job
+    void setDirty(bool dirty);
+    bool isDirty() { return m_version != m_submitted; };
+    uint32_t getVersion() { return m_version; };
+    // when the current burst started, so a job can wait for the rest of it
+    std::chrono::steady_clock::time_point getDirtySince() { return m_dirtySince; };
+    void setLightDirty(bool dirty) { m_lightDirty = dirty; };
+    bool isLightDirty() { return m_lightDirty; };
+    void setComputing(bool computing) { m_computing = computing; };
+    bool isComputing() { return m_computing; };
     bool isEmpty();
+    bool isMaterialized() { return getStorage() != nullptr; };
+    // a pinned chunk outlives its eviction from the map, for jobs waiting on the main thread
+    void pin() { m_pins++; };
+    void unpin() { m_pins--; };
+    bool isPinned() { return m_pins > 0; };
+    void setEvicted(bool evicted) { m_evicted = evicted; };
+    bool isEvicted() { return m_evicted; };
     void setBlock(int x, int y, int z, uint8_t type);
+    void editBlock(int x, int y, int z, uint8_t type);
     uint8_t getBlock(int x, int y, int z);
     void setSunlight(int x, int y, int z, int val);
     int getSunlight(int x, int y, int z);
     void setLight(int x, int y, int z, int val);
     int getLight(int x, int y, int z);
+    void setOpenSky(bool open) { m_openSky = open; };
+    bool hasOpenSky() { return m_openSky; };
+    void setSky(bool sky) { m_sky = sky; };
+    bool isSky() { return m_sky; };
+    Stage getStage() { return m_stage; };
+    void postLight(Lighting::Updates &updates);
+    Lighting::Updates takeLightUpdates();
+    void write(std::ostream &out);
 
     const glm::ivec3 &getCoords() { return m_pos; };
     const glm::vec3 &getCenter() { return m_worldCenter; };
 
 private:
+    struct Storage
+    {
+        uint8_t blocks[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE];
+        uint8_t lightmap[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE];
+    };
+
     void initBlocks();
+    Storage *materialize();
+    Storage *getStorage() const { return m_storage.load(std::memory_order_acquire); };
 
     std::unique_ptr<Mesh> m_mesh;
     bool m_empty;
-    bool m_dirty;
+    // written on the main thread, or by the generator before the chunk is published. jobs get it at submission
+    std::atomic<uint32_t> m_version;
+    uint32_t m_submitted;
+    std::chrono::steady_clock::time_point m_dirtySince;
+    bool m_lightDirty;
     bool m_glDirty;
+    bool m_glLightDirty;
+    bool m_computing;
+    bool m_openSky;
+    bool m_sky;
+    Stage m_stage;
+    int m_meshId;
+    std::atomic<int> m_pins;
+    bool m_evicted;
+
+    std::mutex m_lightMutex;
+    // blocks and light of a published chunk, a job relighting it or an edit writes under the exclusive lock
+    // while jobs for it and its neighbors read under the shared one
+    std::shared_mutex m_dataMutex;
+    Lighting::Updates m_lightUpdates;
 
     glm::ivec3 m_pos;
     glm::vec3 m_worldCenter;
-    uint8_t m_blocks[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE];
-    uint8_t m_lightmap[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE];
+    // placeholders have no storage and read as m_fillBlock/m_fillLight until something writes to them
+    // a worker relighting a placeholder materializes it while the main thread may be reading its blocks, so
+    // the storage is published with release once it is filled and readers load it with acquire
+    std::atomic<Storage*> m_storage;
+    uint8_t m_fillBlock;
+    uint8_t m_fillLight;
     std::vector<float> m_vertices;
+    std::vector<float> m_lighting;
+    std::vector<Face> m_faces;
 };
\ No newline at end of file
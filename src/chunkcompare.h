@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include <glm/glm.hpp>
 
 struct ChunkCompare
@@ -15,4 +18,15 @@ struct ChunkCompare
         else
             return false;
     }
+};
+
+struct ChunkHash
+{
+    size_t operator() (const glm::ivec3 &v) const
+    {
+        uint64_t h = static_cast<uint32_t>(v.x) * 0x9E3779B97F4A7C15ull;
+        h ^= static_cast<uint32_t>(v.y) * 0xC2B2AE3D27D4EB4Full;
+        h ^= static_cast<uint32_t>(v.z) * 0x165667B19E3779F9ull;
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
 };
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "chunkmap.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "chunk.h"
+#include "epoch.h"
+
+ChunkMap::ChunkMap() : m_shards(new Shard[SHARDS])
+{
+}
+
+ChunkMap::~ChunkMap()
+{
+}
+
+std::pair<ChunkMap::iterator, bool> ChunkMap::insert(std::pair<glm::ivec3, std::unique_ptr<Chunk>> &&entry)
+{
+    glm::ivec3 coords = entry.first;
+    Chunk *c = entry.second.get();
+
+    auto result = m_chunks.insert(std::move(entry));
+    if (result.second)
+    {
+        Shard &s = shard(coords);
+        std::lock_guard<std::shared_mutex> lock(s.mutex);
+        s.chunks[coords] = c;
+    }
+
+    return result;
+}
+
+size_t ChunkMap::erase(const glm::ivec3 &coords)
+{
+    std::unique_ptr<Chunk> c = take(coords);
+    if (!c)
+        return 0;
+
+    c->setEvicted(true);
+    m_retired.push_back({ std::move(c), Epoch::retire() });
+    return 1;
+}
+
+void ChunkMap::collect()
+{
+    auto freed = [](const Retired &r) -> bool
+    {
+        return !r.chunk->isPinned() && Epoch::isSafe(r.tag);
+    };
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), freed), m_retired.end());
+}
+
+// unlinks the chunk from both indexes and hands it to the caller, who has to keep it alive for any reader
+std::unique_ptr<Chunk> ChunkMap::take(const glm::ivec3 &coords)
+{
+    auto it = m_chunks.find(coords);
+    if (it == m_chunks.end())
+        return nullptr;
+
+    {
+        Shard &s = shard(coords);
+        std::lock_guard<std::shared_mutex> lock(s.mutex);
+        s.chunks.erase(coords);
+    }
+
+    std::unique_ptr<Chunk> c = std::move(it->second);
+    m_chunks.erase(it);
+    return c;
+}
+
+Chunk *ChunkMap::get(const glm::ivec3 &coords) const
+{
+    Shard &s = shard(coords);
+    std::shared_lock<std::shared_mutex> lock(s.mutex);
+    auto it = s.chunks.find(coords);
+    return it != s.chunks.end() ? it->second : nullptr;
+}
+
+ChunkMap::Shard &ChunkMap::shard(const glm::ivec3 &coords) const
+{
+    return m_shards[ChunkHash()(coords) % SHARDS];
+}
\ No newline at end of file
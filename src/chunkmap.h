@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "chunkcompare.h"
+
+class Chunk;
+
+// the main thread owns the chunks and is the only one inserting, erasing or iterating. any thread can look
+// a chunk up with get(), which reads a sharded index kept next to the ordered map instead of the map itself.
+// off the main thread get() must be called inside an Epoch::Guard, erased chunks are only freed by collect()
+// once no guard that could have found them is still open and no ComputeJob holds them
+class ChunkMap
+{
+public:
+    typedef std::map<glm::ivec3, std::unique_ptr<Chunk>, ChunkCompare> Map;
+    typedef Map::iterator iterator;
+    typedef Map::const_iterator const_iterator;
+
+    ChunkMap();
+    ~ChunkMap();
+
+    std::pair<iterator, bool> insert(std::pair<glm::ivec3, std::unique_ptr<Chunk>> &&entry);
+    size_t erase(const glm::ivec3 &coords);
+    std::unique_ptr<Chunk> take(const glm::ivec3 &coords);
+    void collect();
+    size_t getRetiredAmount() const { return m_retired.size(); };
+
+    iterator find(const glm::ivec3 &coords) { return m_chunks.find(coords); };
+    iterator begin() { return m_chunks.begin(); };
+    iterator end() { return m_chunks.end(); };
+    const_iterator begin() const { return m_chunks.begin(); };
+    const_iterator end() const { return m_chunks.end(); };
+    size_t size() const { return m_chunks.size(); };
+
+    Chunk *get(const glm::ivec3 &coords) const;
+
+private:
+    static const int SHARDS = 64;
+
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<glm::ivec3, Chunk*, ChunkHash> chunks;
+    };
+
+    struct Retired
+    {
+        std::unique_ptr<Chunk> chunk;
+        uint64_t tag;
+    };
+
+    Shard &shard(const glm::ivec3 &coords) const;
+
+    Map m_chunks;
+    std::vector<Retired> m_retired;
+    std::unique_ptr<Shard[]> m_shards;
+};
\ No newline at end of file
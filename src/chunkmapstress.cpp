@@ -0,0 +1,249 @@
+#include "chunkmapstress.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+#include "blocks.h"
+#include "chunk.h"
+#include "chunkmap.h"
+#include "computejob.h"
+#include "epoch.h"
+#include "lighting.h"
+#include "mpscqueue.h"
+#include "random.h"
+#include "terraingenerator.h"
+#include "threadpool.h"
+
+namespace ChunkMapStress
+{
+    static const int RADIUS = 6;
+    static const int JOBS_PER_TICK = 256;
+    static const int LOOKUPS_PER_JOB = 64;
+    static const int PIPELINE_RADIUS = 2;
+    static const int PIPELINE_HEIGHT = 3;
+    static const int EDITS_PER_TICK = 4;
+    static const int TICKS_PER_SLIDE = 16;
+
+    static void load(ChunkMap &chunks, const glm::ivec3 &coords)
+    {
+        uint8_t block = coords.y >= 0 ? Blocks::Air : Blocks::Stone;
+        chunks.insert(std::make_pair(coords, std::make_unique<Chunk>(coords, block, coords.y >= 0 ? 0xF0 : 0)));
+    }
+
+    void run(int seconds)
+    {
+        ThreadPool pool;
+        ChunkMap chunks;
+        std::atomic<long> lookups(0);
+        std::atomic<long> found(0);
+        std::atomic<long> errors(0);
+
+        for (int x = -RADIUS; x <= RADIUS; x++)
+            for (int y = -RADIUS; y <= RADIUS; y++)
+                for (int z = -RADIUS; z <= RADIUS; z++)
+                    load(chunks, glm::ivec3(x, y, z));
+
+        std::cout << "streaming a " << 2 * RADIUS + 1 << "^3 window on " << pool.getWorkerAmount() << " threads for "
+            << seconds << "s" << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        auto end = start + std::chrono::seconds(seconds);
+        int tick = 0;
+        long retired = 0;
+        while (std::chrono::steady_clock::now() < end)
+        {
+            // workers read around the whole window, including the slices being loaded and unloaded
+            for (int i = 0; i < JOBS_PER_TICK; i++)
+            {
+                pool.addJob([&chunks, &lookups, &found, &errors, tick, i]() -> void
+                {
+                    Epoch::Guard guard;
+                    Random::Stream rng(tick, i, 0, 0);
+                    for (int j = 0; j < LOOKUPS_PER_JOB; j++)
+                    {
+                        glm::ivec3 coords(tick - RADIUS - 1 + static_cast<int>(rng.next() % (2 * RADIUS + 3)),
+                            static_cast<int>(rng.next() % (2 * RADIUS + 1)) - RADIUS,
+                            static_cast<int>(rng.next() % (2 * RADIUS + 1)) - RADIUS);
+
+                        Chunk *c = chunks.get(coords);
+                        if (c != nullptr)
+                        {
+                            found++;
+                            if (c->getCoords() != coords || c->getSunlight(0, 0, 0) != (coords.y >= 0 ? 15 : 0))
+                                errors++;
+                        }
+                    }
+                    lookups += LOOKUPS_PER_JOB;
+                });
+            }
+
+            // the window slides one chunk along x while the readers run, and whatever they can no longer see
+            // is freed right away
+            for (int y = -RADIUS; y <= RADIUS; y++)
+            {
+                for (int z = -RADIUS; z <= RADIUS; z++)
+                {
+                    chunks.erase(glm::ivec3(tick - RADIUS, y, z));
+                    load(chunks, glm::ivec3(tick + RADIUS + 1, y, z));
+                }
+            }
+            chunks.collect();
+            retired += chunks.getRetiredAmount();
+
+            pool.waitUntilCompleted();
+            tick++;
+        }
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << tick << " ticks, " << static_cast<long>(lookups / elapsed) << " lookups/s, " << found << " of "
+            << lookups << " found, " << errors << " errors, " << retired / std::max(tick, 1)
+            << " chunks waiting on readers per tick" << std::endl;
+    }
+
+    static void loadGenerated(ChunkMap &chunks, TerrainGenerator &generator, const glm::ivec3 &coords)
+    {
+        std::unique_ptr<Chunk> c;
+        TerrainGenerator::Classification type = generator.classify(coords);
+        if (type == TerrainGenerator::Sky)
+            c = std::make_unique<Chunk>(coords, Blocks::Air, 0xF0);
+        else if (type == TerrainGenerator::Buried)
+            c = std::make_unique<Chunk>(coords, Blocks::Stone, 0);
+        else
+        {
+            c = std::make_unique<Chunk>(coords);
+            generator.generate(*c);
+        }
+
+        Chunk &chunk = *c;
+        chunks.insert(std::make_pair(coords, std::move(c)));
+        Lighting::onLoaded(chunk, chunks);
+        for (int f = 0; f < 6; f++)
+        {
+            auto neighbor = chunks.find(coords + Lighting::faceDirs[f]);
+            if (neighbor != chunks.end() && neighbor->second->isMaterialized())
+                neighbor->second->setDirty(true);
+        }
+    }
+
+    void runPipeline(int seconds)
+    {
+        ThreadPool pool;
+        ChunkMap chunks;
+        TerrainGenerator generator(1);
+        MpscQueue<ComputeJob> done;
+        Random::Stream rng(0, 0, 0, 0);
+        long jobs = 0;
+        long edits = 0;
+        long reads = 0;
+
+        int x0 = -PIPELINE_RADIUS;
+        for (int x = -PIPELINE_RADIUS; x <= PIPELINE_RADIUS; x++)
+            for (int y = 0; y < PIPELINE_HEIGHT; y++)
+                for (int z = -PIPELINE_RADIUS; z <= PIPELINE_RADIUS; z++)
+                    loadGenerated(chunks, generator, glm::ivec3(x, y + 2, z));
+
+        std::cout << "computing a sliding window of " << chunks.size() << " chunks on " << pool.getWorkerAmount()
+            << " threads for " << seconds << "s" << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        auto end = start + std::chrono::seconds(seconds);
+        int tick = 0;
+        while (std::chrono::steady_clock::now() < end)
+        {
+            done.drain(chunks.size(), [&jobs](ComputeJob *finished) -> void
+            {
+                std::unique_ptr<ComputeJob> job(finished);
+                job->transfer();
+                jobs++;
+            });
+
+            // the player's collision and ray casts read blocks on the main thread, placeholders included
+            for (const auto &it : chunks)
+                reads += it.second->getBlock(tick % CHUNK_SIZE, 0, 0) != Blocks::Air;
+
+            // edits land next to running jobs, on their own chunks too, and are remeshed right here like the game's edit path
+            for (int i = 0; i < EDITS_PER_TICK; i++)
+            {
+                glm::ivec3 coords(x0 + static_cast<int>(rng.next() % (2 * PIPELINE_RADIUS + 1)),
+                    2 + static_cast<int>(rng.next() % PIPELINE_HEIGHT),
+                    static_cast<int>(rng.next() % (2 * PIPELINE_RADIUS + 1)) - PIPELINE_RADIUS);
+                auto it = chunks.find(coords);
+                if (it == chunks.end())
+                    continue;
+
+                Chunk &c = *it->second;
+                uint32_t r = rng.next();
+                c.editBlock(r % CHUNK_SIZE, (r >> 4) % CHUNK_SIZE, (r >> 8) % CHUNK_SIZE,
+                    (r >> 12) % 2 ? Blocks::Glowstone : Blocks::Air);
+                c.setDirty(false);
+                c.setLightDirty(false);
+                c.setComputing(true);
+                ComputeJob job(c, chunks, c.getVersion());
+                job.execute();
+                job.transfer();
+                edits++;
+            }
+
+            for (const auto &it : chunks)
+            {
+                Chunk &c = *it.second;
+                if ((!c.isDirty() && !c.isLightDirty()) || c.isComputing())
+                    continue;
+
+                bool lightOnly = !c.isDirty();
+                glm::ivec3 coords = c.getCoords();
+                uint32_t version = c.getVersion();
+                c.setDirty(false);
+                c.setLightDirty(false);
+                c.setComputing(true);
+                pool.addJob([&chunks, &done, coords, version, lightOnly]() -> void
+                {
+                    Epoch::Guard guard;
+                    Chunk *c = chunks.get(coords);
+                    if (c == nullptr)
+                        return;
+
+                    auto job = std::make_unique<ComputeJob>(*c, chunks, version, lightOnly);
+                    job->execute();
+                    done.push(job.release());
+                });
+            }
+
+            if (++tick % TICKS_PER_SLIDE == 0)
+            {
+                for (int y = 0; y < PIPELINE_HEIGHT; y++)
+                {
+                    for (int z = -PIPELINE_RADIUS; z <= PIPELINE_RADIUS; z++)
+                    {
+                        chunks.erase(glm::ivec3(x0, y + 2, z));
+                        generator.release(glm::ivec3(x0, y + 2, z));
+                        loadGenerated(chunks, generator, glm::ivec3(x0 + 2 * PIPELINE_RADIUS + 1, y + 2, z));
+                    }
+                }
+                x0++;
+            }
+            chunks.collect();
+        }
+
+        pool.waitUntilCompleted();
+        done.drain(std::numeric_limits<size_t>::max(), [](ComputeJob *finished) -> void
+        {
+            std::unique_ptr<ComputeJob> job(finished);
+            job->transfer();
+        });
+        chunks.collect();
+
+        // every job has landed, so a chunk still computing would never be picked up again
+        int stuck = 0;
+        for (const auto &it : chunks)
+            stuck += it.second->isComputing();
+
+        std::cout << tick << " ticks, " << jobs << " jobs, " << edits << " edits remeshed on the main thread, "
+            << reads << " solid blocks read, " << chunks.getRetiredAmount() << " chunks still waiting, " << stuck
+            << " still computing" << std::endl;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+// streams chunks through a ChunkMap on the main thread while pool workers look them up and read them, meant
+// to be run in a BLOCK_TSAN build
+namespace ChunkMapStress
+{
+    void run(int seconds);
+    // the game's light and mesh jobs on a sliding window of generated chunks, with block edits remeshed on the
+    // main thread while workers relight and gather around them
+    void runPipeline(int seconds);
+}
\ No newline at end of file
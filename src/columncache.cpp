@@ -0,0 +1,55 @@
+#include "columncache.h"
+
+ColumnCache::ColumnCache(size_t capacity) : m_capacity(capacity)
+{
+
+}
+
+uint64_t ColumnCache::key(int cx, int cz)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cz);
+}
+
+std::shared_ptr<const ColumnData> ColumnCache::get(int cx, int cz, const std::function<void(ColumnData&)> &fill)
+{
+    uint64_t key = ColumnCache::key(cx, cz);
+    std::shared_ptr<Slot> slot;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end())
+        {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+            slot = it->second.slot;
+        }
+        else
+        {
+            if (m_entries.size() >= m_capacity)
+            {
+                m_entries.erase(m_lru.back());
+                m_lru.pop_back();
+            }
+
+            m_lru.push_front(key);
+            slot = std::make_shared<Slot>();
+            m_entries[key] = { slot, m_lru.begin() };
+        }
+    }
+
+    // the first worker to ask fills the column, any others asking meanwhile wait for it
+    std::call_once(slot->once, [&]() { fill(slot->data); slot->ready = true; });
+    return std::shared_ptr<const ColumnData>(slot, &slot->data);
+}
+
+// never fills or waits, returns null unless the column is already done
+std::shared_ptr<const ColumnData> ColumnCache::peek(int cx, int cz)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key(cx, cz));
+    if (it == m_entries.end() || !it->second.slot->ready)
+        return nullptr;
+
+    auto &slot = it->second.slot;
+    return std::shared_ptr<const ColumnData>(slot, &slot->data);
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "chunk.h"
+
+struct ColumnData
+{
+    static const int COLUMNS = CHUNK_SIZE * CHUNK_SIZE;
+
+    int heights[COLUMNS];
+    bool trees[COLUMNS];
+    uint8_t plants[COLUMNS];
+    uint8_t top[COLUMNS];
+    uint8_t filler[COLUMNS];
+    int minHeight;
+    int maxHeight;
+};
+
+class ColumnCache
+{
+public:
+    ColumnCache(size_t capacity);
+
+    std::shared_ptr<const ColumnData> get(int cx, int cz, const std::function<void(ColumnData&)> &fill);
+    std::shared_ptr<const ColumnData> peek(int cx, int cz);
+
+private:
+    struct Slot
+    {
+        Slot() : ready(false) {};
+
+        std::once_flag once;
+        std::atomic<bool> ready;
+        ColumnData data;
+    };
+
+    static uint64_t key(int cx, int cz);
+
+    struct Entry
+    {
+        std::shared_ptr<Slot> slot;
+        std::list<uint64_t>::iterator lru;
+    };
+
+    size_t m_capacity;
+    std::mutex m_mutex;
+    std::list<uint64_t> m_lru;
+    std::unordered_map<uint64_t, Entry> m_entries;
+};
\ No newline at end of file
@@ -1,196 +1,176 @@
 #include "computejob.h"
 
 #include <iostream>
+#include <mutex>
+#include <shared_mutex>
 
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "blocks.h"
+#include "epoch.h"
 #include "geometry.h"
 
-ComputeJob::ComputeJob(Chunk &chunk, ChunkMap &map) :
-    m_chunk(chunk), m_chunkmap(map)
+ComputeJob::ComputeJob(Chunk &chunk, ChunkMap &map, uint32_t version, bool lightOnly) :
+    m_chunk(chunk), m_chunkmap(map), m_lightOnly(lightOnly), m_meshId(0),
+    m_version(version)
 {
-    std::memset(m_data.lightMap, 0, 27 * CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE);
-    std::memset(m_data.typeMap, 0, 27 * CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE);
+    if (m_lightOnly)
+    {
+        std::shared_lock<std::shared_mutex> lock(chunk.m_dataMutex);
+        m_faces = chunk.m_faces;
+        m_meshId = chunk.m_meshId;
+    }
+
+    m_chunk.pin();
 }
 
-void ComputeJob::execute()
+ComputeJob::~ComputeJob()
 {
-    calcLighting();
-    calcSunlight();
-    buildMesh();
+    m_chunk.unpin();
 }
 
-void ComputeJob::transfer()
+void ComputeJob::execute()
 {
-    for (int x = 0; x < CHUNK_SIZE; x++)
+    Epoch::Guard guard;
+    Lighting::Updates updates = m_chunk.takeLightUpdates();
     {
-        for (int y = 0; y < CHUNK_SIZE; y++)
-        {
-            for (int z = 0; z < CHUNK_SIZE; z++)
-            {
-                m_chunk.setLight(x, y, z, m_data.getLight(x + CHUNK_SIZE, y + CHUNK_SIZE, z + CHUNK_SIZE));
-            }
-        }
+        std::unique_lock<std::shared_mutex> lock(m_chunk.m_dataMutex);
+        Lighting::update(m_chunk, updates, m_outbox);
     }
 
-    m_chunk.m_vertices = std::move(m_vertices);
-    m_chunk.m_dirty = false;
-    m_chunk.m_glDirty = true;
-    m_chunk.m_empty = m_empty;
+    gather();
+
+    if (m_lightOnly)
+    {
+        buildLighting();
+    }
+    else
+    {
+        std::shared_lock<std::shared_mutex> lock(m_chunk.m_dataMutex);
+        buildMesh();
+    }
 }
 
-void ComputeJob::getLights(Chunk &c, const glm::ivec3 &delta, std::queue<LightNode> &queue)
+void ComputeJob::transfer()
 {
-    glm::ivec3 d = delta * 16;
-    glm::ivec3 d2 = (delta + 1) * 16;
-    for (int x = 0; x < CHUNK_SIZE; x++)
+    // the chunk was unloaded while this job ran, nothing will read the results
+    if (m_chunk.isEvicted())
+        return;
+
+    const glm::ivec3 &coords = m_chunk.getCoords();
+
+    for (int f = 0; f < 6; f++)
     {
-        for (int y = 0; y < CHUNK_SIZE; y++)
-        {
-            for (int z = 0; z < CHUNK_SIZE; z++)
-            {
-                int type = c.getBlock(x, y, z);
-                m_data.typeMap[d2.x + x][d2.y + y][d2.z + z] = 0;
+        if (m_outbox.faces[f].empty())
+            continue;
 
-                if (Blocks::isLight(type))
-                {
-                    queue.emplace(d.x + x, d.y + y, d.z + z, 15);
-                }
-                else if (type == Blocks::Leaves)
-                {
-                    m_data.typeMap[d2.x + x][d2.y + y][d2.z + z] = 2;
-                }
-                else if (Blocks::isSolid(type))
-                {
-                    m_data.typeMap[d2.x + x][d2.y + y][d2.z + z] = 1;
-                }
-            }
-        }
+        if (Chunk *neighbor = m_chunkmap.get(coords + Lighting::faceDirs[f]))
+            neighbor->postLight(m_outbox.faces[f]);
     }
-}
 
-void ComputeJob::calcLighting()
-{
-    std::queue<LightNode> lightQueue;
-    for (int a = -1; a < 2; a++)
+    if (m_outbox.changed != 0)
     {
-        for (int b = -1; b < 2; b++)
+        for (int i = 0; i < 27; i++)
         {
-            for (int c = -1; c < 2; c++)
-            {
-                if (a == 0 && b == 0 && c == 0)
-                {
-                    getLights(m_chunk, glm::ivec3(0), lightQueue);
-                    continue;
-                }
-                glm::ivec3 coords = m_chunk.getCoords() + glm::ivec3(a, b, c);
-                auto neighbor = m_chunkmap.find(coords);
-                if (neighbor == m_chunkmap.end())
-                    continue;
+            if (!(m_outbox.changed & (1u << i)))
+                continue;
 
-                getLights(*neighbor->second, glm::ivec3(a, b, c), lightQueue);
-            }
+            if (Chunk *neighbor = m_chunkmap.get(coords + glm::ivec3(i / 9 - 1, (i / 3) % 3 - 1, i % 3 - 1)))
+                neighbor->setLightDirty(true);
         }
     }
 
-    const int MIN = -CHUNK_SIZE;
-    const int MAX = 2 * CHUNK_SIZE - 1;
+    // an older job landing after a newer one was handed out leaves the flag to the newer one
+    if (m_version >= m_chunk.m_submitted)
+        m_chunk.m_computing = false;
 
-    while (!lightQueue.empty())
-    {
-        LightNode &node = lightQueue.front();
-        int x = node.x,
-            y = node.y,
-            z = node.z,
-            light = node.light;
-        lightQueue.pop();
-
-        if (light < 1)
-            continue;
-
-        if (x < MIN || x > MAX || y < MIN || y > MAX || z < MIN || z > MAX)
-            continue;
+    // the chunk changed since this job was handed out, it is still dirty and updateNearest meshes it again
+    if (m_version < m_chunk.m_version)
+        return;
 
-        int val = m_data.getLight(x + CHUNK_SIZE, y + CHUNK_SIZE, z + CHUNK_SIZE);
-        if (val >= light)
-            continue;
-
-        uint8_t type = m_data.typeMap[x + CHUNK_SIZE][y + CHUNK_SIZE][z + CHUNK_SIZE];
-        if (type == 1)
-            continue;
+    if (m_lightOnly)
+    {
+        // geometry was rebuilt while this job ran, so the light stream no longer lines up
+        if (m_meshId != m_chunk.m_meshId)
+        {
+            m_chunk.m_lightDirty = true;
+            return;
+        }
 
-        m_data.setLight(x + CHUNK_SIZE, y + CHUNK_SIZE, z + CHUNK_SIZE, light);
-
-        if (type == 2 && light > 1)
-            light -= 2;
-        else
-            light -= 1;
-        lightQueue.emplace(x - 1, y, z, light);
-        lightQueue.emplace(x + 1, y, z, light);
-        lightQueue.emplace(x, y - 1, z, light);
-        lightQueue.emplace(x, y + 1, z, light);
-        lightQueue.emplace(x, y, z - 1, light);
-        lightQueue.emplace(x, y, z + 1, light);
+        m_chunk.m_lighting = std::move(m_lighting);
+        m_chunk.m_glLightDirty = true;
+        if (m_chunk.m_stage == Chunk::Generated)
+            m_chunk.m_stage = Chunk::Lit;
+        return;
     }
+
+    // an edit can land while a job for this chunk still runs, and a light job copies the faces when it starts
+    std::unique_lock<std::shared_mutex> lock(m_chunk.m_dataMutex);
+    m_chunk.m_vertices = std::move(m_vertices);
+    m_chunk.m_lighting = std::move(m_lighting);
+    m_chunk.m_faces = std::move(m_faces);
+    m_chunk.m_meshId++;
+    m_chunk.m_stage = Chunk::Meshed;
+    m_chunk.m_glDirty = true;
+    m_chunk.m_empty = m_empty;
 }
 
-void ComputeJob::calcSunlight()
+void ComputeJob::gather()
 {
-    std::queue<LightNode> lightQueue;
-
-    for (int x = 0; x < CHUNK_SIZE; x++)
+    // the chunk itself plus a one block shell of its neighbors, missing neighbors read as open sky
+    for (int a = -1; a < 2; a++)
     {
-        for (int z = 0; z < CHUNK_SIZE; z++)
+        for (int b = -1; b < 2; b++)
         {
-            if (m_data.typeMap[x + CHUNK_SIZE][31 + CHUNK_SIZE][z + CHUNK_SIZE] == 0)
+            for (int c = -1; c < 2; c++)
             {
-                lightQueue.emplace(x, 31, z, 15);
+                Chunk *chunk = &m_chunk;
+                if (a != 0 || b != 0 || c != 0)
+                    chunk = m_chunkmap.get(m_chunk.getCoords() + glm::ivec3(a, b, c));
+
+                glm::ivec3 d(a, b, c);
+                glm::ivec3 lo = glm::ivec3(d.x < 0 ? CHUNK_SIZE - 1 : 0, d.y < 0 ? CHUNK_SIZE - 1 : 0,
+                    d.z < 0 ? CHUNK_SIZE - 1 : 0);
+                glm::ivec3 hi = glm::ivec3(d.x > 0 ? 0 : CHUNK_SIZE - 1, d.y > 0 ? 0 : CHUNK_SIZE - 1,
+                    d.z > 0 ? 0 : CHUNK_SIZE - 1);
+                glm::ivec3 shift = d * CHUNK_SIZE + 1;
+
+                // one lock at a time, so a job relighting this neighbor can't deadlock against us
+                std::shared_lock<std::shared_mutex> lock;
+                if (chunk != nullptr)
+                    lock = std::shared_lock<std::shared_mutex>(chunk->m_dataMutex);
+
+                for (int x = lo.x; x <= hi.x; x++)
+                {
+                    for (int y = lo.y; y <= hi.y; y++)
+                    {
+                        for (int z = lo.z; z <= hi.z; z++)
+                        {
+                            uint8_t &type = m_data.typeMap[x + shift.x][y + shift.y][z + shift.z];
+                            uint8_t &light = m_data.lightMap[x + shift.x][y + shift.y][z + shift.z];
+                            if (chunk == nullptr)
+                            {
+                                type = 0;
+                                light = 0xF0;
+                                continue;
+                            }
+
+                            int block = chunk->getBlock(x, y, z);
+                            if (Blocks::isLight(block))
+                                type = 0;
+                            else if (block == Blocks::Leaves)
+                                type = 2;
+                            else if (Blocks::isSolid(block))
+                                type = 1;
+                            else
+                                type = 0;
+                            light = static_cast<uint8_t>(chunk->getLight(x, y, z) | (chunk->getSunlight(x, y, z) << 4));
+                        }
+                    }
+                }
             }
         }
     }
-
-    const int MIN = -CHUNK_SIZE;
-    const int MAX = 2 * CHUNK_SIZE - 1;
-
-    while (!lightQueue.empty())
-    {
-        LightNode &node = lightQueue.front();
-        int x = node.x,
-            y = node.y,
-            z = node.z,
-            light = node.light;
-        lightQueue.pop();
-
-        if (light < 1)
-            continue;
-
-        if (x < MIN || x > MAX || y < MIN || y > MAX || z < MIN || z > MAX)
-            continue;
-
-        int val = m_data.getSunlight(x + CHUNK_SIZE, y + CHUNK_SIZE, z + CHUNK_SIZE);
-        if (val >= light)
-            continue;
-
-        uint8_t type = m_data.typeMap[x + CHUNK_SIZE][y + CHUNK_SIZE][z + CHUNK_SIZE];
-        if (type == 1)
-            continue;
-
-        m_data.setSunlight(x + CHUNK_SIZE, y + CHUNK_SIZE, z + CHUNK_SIZE, light);
-
-        bool max = light == 15;
-
-        if (type == 2 && light > 1)
-            light -= 2;
-        else
-            light -= 1;
-        lightQueue.emplace(x - 1, y, z, light);
-        lightQueue.emplace(x + 1, y, z, light);
-        lightQueue.emplace(x, y - 1, z, max ? 15 : light);
-        lightQueue.emplace(x, y + 1, z, light);
-        lightQueue.emplace(x, y, z - 1, light);
-        lightQueue.emplace(x, y, z + 1, light);
-    }
 }
 
 void ComputeJob::smoothLighting(int x, int y, int z, float light[6][4])
@@ -231,7 +211,7 @@ void ComputeJob::smoothLighting(int x, int y, int z, float light[6][4])
     }
 }
 
-void ComputeJob::smoothLighting2(int x, int y, int z, float light[6][4], float sunlight[6][4])
+void ComputeJob::smoothLighting2(int x, int y, int z, int face, float light[4], float sunlight[4])
 {
     static const glm::ivec3 start[6][4] = {
         { glm::ivec3(-1, -1, 1), glm::ivec3(-1, 0, 1), glm::ivec3(0, 0, 1), glm::ivec3(0, -1, 1) },
@@ -251,24 +231,21 @@ void ComputeJob::smoothLighting2(int x, int y, int z, float light[6][4], float s
         { glm::ivec3(0, 0, 0), glm::ivec3(0, 0, 1), glm::ivec3(1, 0, 1), glm::ivec3(1, 0, 0) }
     };
 
-    for (int i = 0; i < 6; i++)
+    for (int j = 0; j < 4; j++)
     {
-        for (int j = 0; j < 4; j++)
+        glm::ivec3 pos = start[face][j] + glm::ivec3(x, y, z);
+        float blockVal = 0.0f;
+        float sunVal = 0.0f;
+        for (int k = 0; k < 4; k++)
         {
-            glm::ivec3 pos = start[i][j] + glm::ivec3(x, y, z);
-            float blockVal = 0.0f;
-            float sunVal = 0.0f;
-            for (int k = 0; k < 4; k++)
-            {
-                const glm::ivec3 &d = off[i][k];
-                blockVal += static_cast<float>(
-                    m_data.getLight(pos.x + d.x, pos.y + d.y, pos.z + d.z));
-                sunVal += static_cast<float>(
-                    m_data.getSunlight(pos.x + d.x, pos.y + d.y, pos.z + d.z));
-            }
-            light[i][j] = blockVal / 4.0f;
-            sunlight[i][j] = sunVal / 4.0f;
+            const glm::ivec3 &d = off[face][k];
+            blockVal += static_cast<float>(
+                m_data.getLight(pos.x + d.x, pos.y + d.y, pos.z + d.z));
+            sunVal += static_cast<float>(
+                m_data.getSunlight(pos.x + d.x, pos.y + d.y, pos.z + d.z));
         }
+        light[j] = blockVal / 4.0f;
+        sunlight[j] = sunVal / 4.0f;
     }
 }
 
@@ -289,8 +266,11 @@ void ComputeJob::faceLighting(int x, int y, int z, float light[6][4])
 
 void ComputeJob::buildMesh()
 {
-    int total = 0;
     m_vertices.clear();
+    m_lighting.clear();
+    m_faces.clear();
+
+    const glm::ivec3 &pos = m_chunk.getCoords();
 
     for (int x = 0; x < CHUNK_SIZE; x++)
     {
@@ -298,21 +278,28 @@ void ComputeJob::buildMesh()
         {
             for (int z = 0; z < CHUNK_SIZE; z++)
             {
-                if (m_chunk.getBlock(x, y, z) == Blocks::Air)
+                int type = m_chunk.getBlock(x, y, z);
+                if (type == Blocks::Air)
                     continue;
 
-                bool visible[6] = { true, true, true, true, true, true };
-                float light[6][4] = { 0.0f };
-                float sunlight[6][4] = { 0.0f };
+                int dx = x + 1;
+                int dy = y + 1;
+                int dz = z + 1;
 
-                int dx = x + CHUNK_SIZE;
-                int dy = y + CHUNK_SIZE;
-                int dz = z + CHUNK_SIZE;
+                float wx = static_cast<float>(x + pos.x * 16);
+                float wy = static_cast<float>(y + pos.y * 16);
+                float wz = static_cast<float>(z + pos.z * 16);
 
-                //smoothLighting(dx, dy, dz, light);
-                smoothLighting2(dx, dy, dz, light, sunlight);
-                //faceLighting(dx, dy, dz, light);
+                if (Blocks::isPlant(type))
+                {
+                    Geometry::makePlant(m_vertices, wx, wy, wz, type);
+                    Geometry::makePlantLight(m_lighting, m_data.getLight(dx, dy, dz), m_data.getSunlight(dx, dy, dz));
+                    m_faces.push_back({ static_cast<uint8_t>(x), static_cast<uint8_t>(y), static_cast<uint8_t>(z),
+                        Chunk::Face::Plant, false });
+                    continue;
+                }
 
+                bool visible[6];
                 visible[0] = m_data.typeMap[dx][dy][dz + 1] != 1;
                 visible[1] = m_data.typeMap[dx][dy][dz - 1] != 1;
                 visible[2] = m_data.typeMap[dx - 1][dy][dz] != 1;
@@ -320,24 +307,50 @@ void ComputeJob::buildMesh()
                 visible[4] = m_data.typeMap[dx][dy + 1][dz] != 1;
                 visible[5] = m_data.typeMap[dx][dy - 1][dz] != 1;
 
-                const glm::ivec3 &pos = m_chunk.getCoords();
-                int type = m_chunk.getBlock(x, y, z);
-
-                if (Blocks::isPlant(type))
+                for (int i = 0; i < 6; i++)
                 {
-                    Geometry::makePlant(m_vertices, x + pos.x * 16, y + pos.y * 16, z + pos.z * 16,
-                        type, m_data.getLight(dx, dy, dz), m_data.getSunlight(dx, dy, dz));
+                    if (!visible[i])
+                        continue;
+
+                    float light[4];
+                    float sunlight[4];
+                    //smoothLighting(dx, dy, dz, light);
+                    smoothLighting2(dx, dy, dz, i, light, sunlight);
+                    //faceLighting(dx, dy, dz, light);
+
+                    // https://0fps.net/2013/07/03/ambient-occlusion-for-minecraft-like-worlds/
+                    bool flip = light[0] + light[2] > light[1] + light[3];
+                    Geometry::makeFace(m_vertices, wx, wy, wz, i, type, flip);
+                    Geometry::makeFaceLight(m_lighting, flip, light, sunlight);
+                    m_faces.push_back({ static_cast<uint8_t>(x), static_cast<uint8_t>(y), static_cast<uint8_t>(z),
+                        static_cast<uint8_t>(i), flip });
                 }
-                else
-                {
-                    Geometry::makeCube(m_vertices, x + pos.x * 16, y + pos.y * 16, z + pos.z * 16, visible,
-                        type, light, sunlight);
-                }
-
-                for (int i = 0; i < 6; i++) total += visible[i] ? 1 : 0;
             }
         }
     }
 
-    m_empty = total == 0;
+    m_empty = m_faces.empty();
+}
+
+void ComputeJob::buildLighting()
+{
+    m_lighting.clear();
+
+    for (const auto &face : m_faces)
+    {
+        int dx = face.x + 1;
+        int dy = face.y + 1;
+        int dz = face.z + 1;
+
+        if (face.face == Chunk::Face::Plant)
+        {
+            Geometry::makePlantLight(m_lighting, m_data.getLight(dx, dy, dz), m_data.getSunlight(dx, dy, dz));
+            continue;
+        }
+
+        float light[4];
+        float sunlight[4];
+        smoothLighting2(dx, dy, dz, face.face, light, sunlight);
+        Geometry::makeFaceLight(m_lighting, face.flip, light, sunlight);
+    }
 }
\ No newline at end of file
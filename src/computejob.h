@@ -1,66 +1,57 @@
 #pragma once
 
-#include <queue>
 #include <vector>
 
 #include "chunk.h"
+#include "mpscqueue.h"
 
-class ComputeJob
+// finished jobs can go back to the main thread through an MpscQueue
+class ComputeJob : public MpscNode
 {
 public:
-    ComputeJob(Chunk &chunk, ChunkMap &map);
+    // version is the one the chunk had when the job was handed out
+    ComputeJob(Chunk &chunk, ChunkMap &map, uint32_t version, bool lightOnly = false);
+    ~ComputeJob();
 
     void execute();
 
     void transfer();
 
 private:
+    static const int DATA_SIZE = CHUNK_SIZE + 2;
+
     struct ChunkData
     {
-        uint8_t lightMap[3 * CHUNK_SIZE][3 * CHUNK_SIZE][3 * CHUNK_SIZE];
-        uint8_t typeMap[48][48][48];
-
-        void setLight(int x, int y, int z, int val)
-        {
-            lightMap[x][y][z] = (lightMap[x][y][z] & 0xF0) | val;
-        }
+        uint8_t lightMap[DATA_SIZE][DATA_SIZE][DATA_SIZE];
+        uint8_t typeMap[DATA_SIZE][DATA_SIZE][DATA_SIZE];
 
         int getLight(int x, int y, int z)
         {
             return (lightMap[x][y][z]) & 0xF;
         }
 
-        void setSunlight(int x, int y, int z, int val)
-        {
-            lightMap[x][y][z] = (lightMap[x][y][z] & 0xF) | (val << 4);
-        }
-
         int getSunlight(int x, int y, int z)
         {
             return (lightMap[x][y][z] >> 4) & 0xF;
         }
     };
 
-    struct LightNode
-    {
-        LightNode(int _x, int _y, int _z, int _light)
-            : x(_x), y(_y), z(_z), light(_light) {};
-
-        int x, y, z;
-        uint8_t light;
-    };
-
-    void getLights(Chunk &c, const glm::ivec3 &delta, std::queue<LightNode> &queue);
-    void calcLighting();
-    void calcSunlight();
+    void gather();
     void smoothLighting(int x, int y, int z, float light[6][4]);
-    void smoothLighting2(int x, int y, int z, float light[6][4], float sunlight[6][4]);
+    void smoothLighting2(int x, int y, int z, int face, float light[4], float sunlight[4]);
     void faceLighting(int x, int y, int z, float light[6][4]);
     void buildMesh();
+    void buildLighting();
 
     ChunkMap &m_chunkmap;
     Chunk &m_chunk;
     std::vector<float> m_vertices;
+    std::vector<float> m_lighting;
+    std::vector<Chunk::Face> m_faces;
     ChunkData m_data;
     bool m_empty;
+    bool m_lightOnly;
+    int m_meshId;
+    uint32_t m_version;
+    Lighting::Outbox m_outbox;
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+// fire and forget coroutine, it starts running right away and frees itself when it finishes
+struct Task
+{
+    struct promise_type
+    {
+        Task get_return_object() { return {}; };
+        std::suspend_never initial_suspend() noexcept { return {}; };
+        std::suspend_never final_suspend() noexcept { return {}; };
+        void return_void() {};
+        void unhandled_exception() { std::terminate(); };
+    };
+};
+
+// owns a suspended coroutine until something resumes it, dropping it destroys the frame so a cancelled job
+// takes its coroutine with it
+class Resume
+{
+public:
+    Resume() : m_handle(nullptr) {};
+    explicit Resume(std::coroutine_handle<> handle) : m_handle(handle) {};
+    Resume(Resume &&other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {};
+    Resume &operator=(Resume &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_handle)
+                m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    };
+    ~Resume()
+    {
+        if (m_handle)
+            m_handle.destroy();
+    };
+
+    Resume(const Resume&) = delete;
+    Resume &operator=(const Resume&) = delete;
+
+    void operator()() { std::exchange(m_handle, nullptr).resume(); };
+    explicit operator bool() const { return m_handle != nullptr; };
+
+private:
+    std::coroutine_handle<> m_handle;
+};
+
+// suspends and hands the coroutine to submit, which decides where it continues
+template<typename F>
+struct Switch
+{
+    F submit;
+
+    bool await_ready() { return false; };
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        // the coroutine may resume elsewhere before submit returns, so nothing in its frame is touched after
+        F f = std::move(submit);
+        f(Resume(handle));
+    };
+    void await_resume() {};
+};
+
+template<typename F>
+Switch<F> switchTo(F submit)
+{
+    return { std::move(submit) };
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "epoch.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace Epoch
+{
+    static const int MAX_THREADS = 256;
+
+    struct alignas(64) Announcement
+    {
+        // 0 while the thread is outside any guard
+        std::atomic<uint64_t> epoch{ 0 };
+    };
+
+    static std::atomic<uint64_t> global(1);
+    static Announcement announcements[MAX_THREADS];
+    static std::atomic<int> used(0);
+    static std::mutex freeMutex;
+    static std::vector<int> freeSlots;
+
+    // a slot per thread that ever enters a guard, handed back when the thread exits
+    struct Slot
+    {
+        Slot() : index(-1), depth(0)
+        {
+            std::lock_guard<std::mutex> lock(freeMutex);
+            if (!freeSlots.empty())
+            {
+                index = freeSlots.back();
+                freeSlots.pop_back();
+            }
+            else if (used < MAX_THREADS)
+            {
+                index = used++;
+            }
+            else
+            {
+                // a guard without a slot wouldn't hold back reclamation, so readers could touch freed memory
+                std::cout << "error: more than " << MAX_THREADS << " threads entered an epoch guard" << std::endl;
+                std::abort();
+            }
+        }
+
+        ~Slot()
+        {
+            std::lock_guard<std::mutex> lock(freeMutex);
+            freeSlots.push_back(index);
+        }
+
+        int index;
+        int depth;
+    };
+
+    static thread_local Slot slot;
+
+    Guard::Guard()
+    {
+        if (slot.depth++ > 0)
+            return;
+
+        announcements[slot.index].epoch.store(global.load(), std::memory_order_seq_cst);
+    }
+
+    Guard::~Guard()
+    {
+        if (--slot.depth > 0)
+            return;
+
+        announcements[slot.index].epoch.store(0, std::memory_order_release);
+    }
+
+    uint64_t retire()
+    {
+        return global.fetch_add(1);
+    }
+
+    bool isSafe(uint64_t tag)
+    {
+        int n = used;
+        for (int i = 0; i < n; i++)
+        {
+            uint64_t epoch = announcements[i].epoch.load(std::memory_order_seq_cst);
+            if (epoch != 0 && epoch <= tag)
+                return false;
+        }
+
+        return true;
+    }
+}
\ No newline at end of file
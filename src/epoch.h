@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// epoch based reclamation. a thread reads shared objects inside a Guard, and an object unlinked at epoch e
+// can be freed once no thread is still inside a guard it entered at or before e
+namespace Epoch
+{
+    class Guard
+    {
+    public:
+        Guard();
+        ~Guard();
+
+        Guard(const Guard&) = delete;
+        Guard &operator=(const Guard&) = delete;
+    };
+
+    // tags an object that was just unlinked, call after it is unreachable for new readers
+    uint64_t retire();
+    bool isSafe(uint64_t tag);
+}
\ No newline at end of file
@@ -12,10 +12,12 @@
 
 #include "blocks.h"
 #include "chunk.h"
+#include "epoch.h"
+#include "lighting.h"
 
-Game::Game(GLFWwindow *window) : m_window(window), m_camera(glm::vec3(-88, 55, -28)),
-    m_chunkGenerator(), m_processed(), m_renderer(m_chunks), m_player(glm::vec3(-88, 55, -28), m_camera),
-    m_input(window)
+Game::Game(GLFWwindow *window, uint64_t seed, const ThreadLanes::Settings &lanes) : m_lanes(lanes),
+    m_chunkGenerator(seed), m_renderer(m_chunks), m_input(window), m_window(window), m_camera(glm::vec3(-88, 55, -28)),
+    m_player(glm::vec3(-88, 55, -28), m_camera)
 {
     glfwGetWindowSize(m_window, &m_width, &m_height);
     m_renderer.resize(m_width, m_height);
@@ -77,7 +79,7 @@ void Game::run()
             char title[256];
             title[255] = '\0';
             snprintf(title, 255, "block - [FPS: %ld] [%zd chunks] [%d jobs queued] [pos: %f, %f, %f] [chunk: %d %d %d]", 
-                nFrames, m_chunks.size(), m_pool.getJobsAmount(),
+                nFrames, m_chunks.size(), m_lanes.getJobsAmount(),
                 m_camera.getPos().x, m_camera.getPos().y, m_camera.getPos().z, ipos.x, ipos.y, ipos.z);
             glfwSetWindowTitle(m_window, title);
             lastTime += 1.0f;
@@ -197,15 +199,16 @@ void Game::processInput(float dt)
 
                 glm::vec3 integral(16.0f);
                 glm::ivec3 ipos2 = glm::mod(rpos, integral);
-                c->setBlock(ipos2.x, ipos2.y, ipos2.z, block);
-                dirtyChunks(coords);
+                c->editBlock(ipos2.x, ipos2.y, ipos2.z, block);
+                dirtyChunks(coords, ipos2);
+                m_edits.push_back(coords);
                 m_cooldown = 0.0f;
             }
         }
     }
 }
 
-void Game::loadNearest(const glm::ivec3 &center, int maxJobs)
+void Game::loadNearest(const glm::ivec3 &center, const glm::ivec3 &ahead, int maxJobs)
 {
     for (int i = 0; i < maxJobs; i++)
     {
@@ -223,9 +226,7 @@ void Game::loadNearest(const glm::ivec3 &center, int maxJobs)
                     if (m_loadedChunks.find(coords) != m_loadedChunks.end())
                         continue;
 
-                    int visible = !m_frustum.boxInFrustum(static_cast<glm::vec3>(coords * 16), glm::vec3(16));
-                    int distance = abs(x) + abs(y) + abs(z);
-                    int score = visible << 8 | distance;
+                    int score = jobPriority(coords, ahead);
                     if (score < bestScore)
                     {
                         bestScore = score;
@@ -236,28 +237,189 @@ void Game::loadNearest(const glm::ivec3 &center, int maxJobs)
             }
         }
 
-        if (found)
+        if (!found)
+            break;
+
+        if (m_generationMode == GenerationMode::Column)
         {
-            Chunk *c = new Chunk(bestCoords);
+            loadColumn(center, bestCoords, bestScore);
+        }
+        else if (!loadPlaceholder(bestCoords))
+        {
+            std::vector<std::unique_ptr<Chunk>> chunks;
+            chunks.push_back(std::make_unique<Chunk>(bestCoords));
             m_loadedChunks.insert(bestCoords);
-            auto lambda = [c, this]() -> void
+            streamChunks(std::move(chunks), bestScore);
+        }
+    }
+
+    submitJobs();
+}
+
+// chunks the generator can classify without generating go straight in, all air or all stone
+bool Game::loadPlaceholder(const glm::ivec3 &coords)
+{
+    TerrainGenerator::Classification type = m_chunkGenerator.classify(coords);
+    if (type == TerrainGenerator::Generate)
+        return false;
+
+    std::unique_ptr<Chunk> c;
+    if (type == TerrainGenerator::Sky)
+        c = std::make_unique<Chunk>(coords, Blocks::Air, 0xF0);
+    else
+        c = std::make_unique<Chunk>(coords, Blocks::Stone, 0);
+
+    m_loadedChunks.insert(coords);
+    insertChunk(std::move(c));
+    return true;
+}
+
+void Game::insertChunk(std::unique_ptr<Chunk> c)
+{
+    glm::ivec3 coords = c->getCoords();
+    Chunk &chunk = *c;
+    m_chunks.insert(std::make_pair(coords, std::move(c)));
+    Lighting::onLoaded(chunk, m_chunks);
+
+    for (int x = -1; x < 2; x++)
+    {
+        for (int y = -1; y < 2; y++)
+        {
+            for (int z = -1; z < 2; z++)
             {
-                m_chunkGenerator.generate(*c);
-                c->compute(m_chunks);
-                std::unique_ptr<Chunk> ptr(c);
-                m_processed.push_back(ptr);
-            };
-            m_pool.addJob(lambda);
+                auto neighbor = m_chunks.find(coords + glm::ivec3(x, y, z));
+                if (neighbor == m_chunks.end())
+                    continue;
+
+                // placeholders are only classified when their surroundings can't expose them
+                if (abs(x) + abs(y) + abs(z) <= 1 && neighbor->second->isMaterialized())
+                    neighbor->second->setDirty(true);
+                else
+                    neighbor->second->setLightDirty(true);
+            }
         }
-        else
+    }
+}
+
+void Game::loadColumn(const glm::ivec3 &center, const glm::ivec3 &coords, int priority)
+{
+    // one job generates every missing chunk of the x,z stack in load range and shares its column noise
+    std::vector<std::unique_ptr<Chunk>> column;
+    for (int y = center.y + m_loadDistance; y >= center.y - m_loadDistance; y--)
+    {
+        glm::ivec3 pos(coords.x, y, coords.z);
+        if (m_loadedChunks.find(pos) != m_loadedChunks.end() || loadPlaceholder(pos))
+            continue;
+
+        column.push_back(std::make_unique<Chunk>(pos));
+        m_loadedChunks.insert(pos);
+    }
+
+    if (!column.empty())
+        streamChunks(std::move(column), priority);
+}
+
+void Game::queueJob(ThreadLanes::Work work, Job job, int priority, const std::vector<glm::ivec3> &chunks)
+{
+    Batch &batch = m_batches[m_lanes.getSettings().routes[work]];
+    batch.jobs.push_back(std::move(job));
+    batch.priorities.push_back(priority);
+    batch.entries.push_back({ chunks, work });
+}
+
+// everything queued this pass goes to the pool at once
+void Game::submitJobs()
+{
+    for (int lane = 0; lane < ThreadLanes::LANE_AMOUNT; lane++)
+    {
+        Batch &batch = m_batches[lane];
+        ThreadPool &pool = m_lanes.get(static_cast<ThreadLanes::Lane>(lane));
+        std::vector<std::shared_ptr<ThreadPool::Handle>> handles = pool.addJobs(batch.jobs, batch.priorities);
+        for (size_t i = 0; i < handles.size(); i++)
         {
-            break;
+            for (const glm::ivec3 &coords : batch.entries[i].chunks)
+                m_jobs[coords] = { handles[i], &pool, batch.entries[i].work };
+        }
+
+        batch.priorities.clear();
+        batch.entries.clear();
+    }
+}
+
+// lower runs first, chunks in view before the rest, then by distance from where the player is heading
+int Game::jobPriority(const glm::ivec3 &coords, const glm::ivec3 &ahead)
+{
+    int visible = !m_frustum.boxInFrustum(static_cast<glm::vec3>(coords * 16), glm::vec3(16));
+    int distance = abs(coords.x - ahead.x) + abs(coords.y - ahead.y) + abs(coords.z - ahead.z);
+    return visible << 8 | distance;
+}
+
+// queued jobs follow the player, the ones for chunks that left the erase range are dropped before they start
+void Game::updateJobs(const glm::ivec3 &ahead)
+{
+    for (auto it = m_jobs.begin(); it != m_jobs.end();)
+    {
+        const glm::ivec3 &coords = it->first;
+        ThreadPool::Handle &handle = *it->second.handle;
+
+        glm::vec3 center = static_cast<glm::vec3>(coords * 16) + glm::vec3(8.0f);
+        if (glm::distance(center, m_camera.getPos()) > m_eraseDistance)
+            it->second.pool->cancel(handle);
+
+        // every chunk of a cancelled column passes through here and becomes loadable again
+        if (handle.isCancelled())
+        {
+            if (it->second.work == ThreadLanes::Generate)
+                m_loadedChunks.erase(coords);
+            else if (Chunk *c = getChunk(m_chunks, coords))
+                c->setComputing(false);
+        }
+
+        if (handle.isFinished())
+        {
+            it = m_jobs.erase(it);
+            continue;
+        }
+
+        // edits keep their place at the front
+        if (it->second.work != ThreadLanes::Edit)
+            handle.setPriority(jobPriority(coords, ahead));
+        it++;
+    }
+
+    m_lanes.reprioritize();
+}
+
+// whether the neighbors in load range that a stage reads are there, lighting reads the six it exchanges light
+// with and meshing all 26
+bool Game::neighborsLoaded(const glm::ivec3 &coords, bool mesh)
+{
+    for (int x = -1; x < 2; x++)
+    {
+        for (int y = -1; y < 2; y++)
+        {
+            for (int z = -1; z < 2; z++)
+            {
+                glm::ivec3 d(x, y, z);
+                if ((!mesh && abs(x) + abs(y) + abs(z) != 1) || d == glm::ivec3(0))
+                    continue;
+
+                glm::ivec3 offset = glm::abs(coords + d - m_center);
+                if (std::max(offset.x, std::max(offset.y, offset.z)) > m_loadDistance)
+                    continue;
+
+                if (m_chunks.get(coords + d) == nullptr)
+                    return false;
+            }
         }
     }
+
+    return true;
 }
 
-void Game::updateNearest(const glm::ivec3 &center, int maxJobs)
+void Game::updateNearest(const glm::ivec3 &ahead, int maxJobs)
 {
+    auto settled = std::chrono::steady_clock::now() - std::chrono::duration<double>(COALESCE_WINDOW);
     for (int i = 0; i < maxJobs; i++)
     {
         bool found = false;
@@ -267,13 +429,14 @@ void Game::updateNearest(const glm::ivec3 &center, int maxJobs)
         for (const auto& it : m_chunks)
         {
             auto& chunk = it.second;
-            if (!chunk->isDirty())
+            if ((!chunk->isDirty() && !chunk->isLightDirty()) || chunk->isComputing())
                 continue;
 
-            const glm::ivec3 &coords = chunk->getCoords();
-            int visible = !m_frustum.boxInFrustum(static_cast<glm::vec3>(coords * 16), glm::vec3(16));
-            int distance = abs(coords.x - center.x) + abs(coords.y - center.y) + abs(coords.z - center.z);
-            int score = visible << 8 | distance;
+            // neighbors streaming in or structures landing dirty a chunk several times in a row
+            if (chunk->isDirty() && chunk->getDirtySince() > settled)
+                continue;
+
+            int score = jobPriority(chunk->getCoords(), ahead);
             if (score < bestScore)
             {
                 bestScore = score;
@@ -284,28 +447,104 @@ void Game::updateNearest(const glm::ivec3 &center, int maxJobs)
 
         if (found)
         {
+            const glm::ivec3 &coords = bestChunk->getCoords();
+            bool lightOnly = !bestChunk->isDirty();
+            uint32_t version = bestChunk->getVersion();
             bestChunk->setDirty(false);
-            auto update = [this, bestChunk]() -> void
-            {
-                auto compute = std::make_unique<ComputeJob>(*bestChunk, m_chunks);
-                compute->execute();
-                m_updates.push_back(compute);
-            };
-            m_pool.addJob(update);
+            bestChunk->setLightDirty(false);
+            bestChunk->setComputing(true);
+            updateChunk(coords, lightOnly, version, ThreadLanes::Update, bestScore);
         }
         else
         {
             break;
         }
     }
+
+    submitJobs();
+}
+
+// chunks the player edited this tick are remeshed right here so the next frame shows them, then the
+// neighbors that changed with them while the budget lasts. the rest go to the front of the interactive lane
+void Game::updateEdits()
+{
+    if (m_edits.empty())
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<glm::ivec3> queue;
+    std::swap(queue, m_edits);
+    size_t edited = queue.size();
+    std::set<glm::ivec3, ChunkCompare> seen;
+
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        glm::ivec3 coords = queue[i];
+        Chunk *c = getChunk(m_chunks, coords);
+        if (c == nullptr || !seen.insert(coords).second)
+            continue;
+
+        // edits don't wait behind a queue, a queued job is dropped. an edited chunk also outruns a running one,
+        // which loses to this newer version in transfer, a neighbor waits for it and stays dirty for updateNearest
+        if (c->isComputing())
+        {
+            auto job = m_jobs.find(coords);
+            if (job != m_jobs.end() && job->second.work != ThreadLanes::Generate)
+            {
+                ThreadPool::Handle &handle = *job->second.handle;
+                if (!job->second.pool->cancel(handle) && !handle.isFinished() && i >= edited)
+                    continue;
+            }
+        }
+
+        if (!c->isDirty() && !c->isLightDirty())
+            continue;
+
+        bool lightOnly = !c->isDirty();
+        uint32_t version = c->getVersion();
+        c->setDirty(false);
+        c->setLightDirty(false);
+        c->setComputing(true);
+
+        // the edited chunks themselves always run here
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (i >= edited && elapsed > EDIT_BUDGET)
+        {
+            updateChunk(coords, lightOnly, version, ThreadLanes::Edit, EDIT_PRIORITY);
+            continue;
+        }
+
+        ComputeJob job(*c, m_chunks, version, lightOnly);
+        job.execute();
+        job.transfer();
+
+        if (i >= edited)
+            continue;
+
+        for (int x = -1; x < 2; x++)
+        {
+            for (int y = -1; y < 2; y++)
+            {
+                for (int z = -1; z < 2; z++)
+                {
+                    if (x != 0 || y != 0 || z != 0)
+                        queue.push_back(coords + glm::ivec3(x, y, z));
+                }
+            }
+        }
+    }
 }
 
 void Game::updateChunks()
 {
-    glm::ivec3 current = static_cast<glm::vec3>(glm::floor(m_camera.getPos() / 16.0f));
-    int maxJobs = std::max(m_pool.getWorkerAmount() - m_pool.getJobsAmount(), 1);
+    m_center = static_cast<glm::vec3>(glm::floor(m_camera.getPos() / 16.0f));
+    m_ahead = static_cast<glm::vec3>(glm::floor((m_camera.getPos() + m_player.getVelocity() * LOOKAHEAD) / 16.0f));
 
-    loadNearest(current, maxJobs);
+    updateJobs(m_ahead);
+
+    // each pass queues about as many jobs as its lane has idle workers
+    ThreadPool &generate = m_lanes.get(ThreadLanes::Generate);
+    loadNearest(m_center, m_ahead, std::max(generate.getWorkerAmount() - generate.getJobsAmount(), 1));
 
     for (const auto &it : m_chunks)
     {
@@ -320,57 +559,163 @@ void Game::updateChunks()
     {
         m_chunks.erase(chunk);
         m_loadedChunks.erase(chunk);
+        m_chunkGenerator.release(chunk);
     }
     m_toErase.clear();
 
-    updateNearest(current, maxJobs);
+    // coroutines resumed here can move on to their next worker stage
+    m_mainThread.run(MAX_RESUMES_PER_TICK);
+    updateEdits();
+    submitJobs();
+
+    ThreadPool &update = m_lanes.get(ThreadLanes::Update);
+    updateNearest(m_ahead, std::max(update.getWorkerAmount() - update.getJobsAmount(), 1));
+    placeLateStructures();
+    m_chunks.collect();
+}
 
-    auto move = [this](std::unique_ptr<Chunk> &c) -> void
+// generates on a worker and inserts on the main thread, then every chunk goes on to its first light and mesh
+Task Game::streamChunks(std::vector<std::unique_ptr<Chunk>> chunks, int priority)
+{
+    std::vector<glm::ivec3> coords;
+    for (auto &c : chunks)
+        coords.push_back(c->getCoords());
+
+    co_await onWorker(ThreadLanes::Generate, priority, coords);
+
+    if (m_generationMode == GenerationMode::Column)
     {
-        glm::ivec3 coords = c->getCoords();
-        m_chunks.insert(std::make_pair(coords, std::move(c)));
+        std::vector<Chunk*> column;
+        for (auto &c : chunks)
+            column.push_back(c.get());
 
-        for (int x = -1; x < 2; x++)
+        m_chunkGenerator.generateColumn(column);
+    }
+    else
+    {
+        for (auto &c : chunks)
+            m_chunkGenerator.generate(*c);
+    }
+
+    co_await m_mainThread.resume();
+
+    // computing keeps updateNearest away while the chunk is in its pipeline
+    for (auto &c : chunks)
+    {
+        c->setComputing(true);
+        insertChunk(std::move(c));
+    }
+
+    for (const glm::ivec3 &p : coords)
+        prepareChunk(p);
+}
+
+// a new chunk is lit once its face neighbors in load range are there and meshed once all 26 are, so initial
+// streaming meshes it once instead of again for every neighbor that arrives later
+Task Game::prepareChunk(glm::ivec3 coords)
+{
+    for (int stage = 0; stage < 2; stage++)
+    {
+        bool lightOnly = stage == 0;
+        co_await m_mainThread.until([this, coords, lightOnly]() -> bool
         {
-            for (int y = -1; y < 2; y++)
-            {
-                for (int z = -1; z < 2; z++)
-                {
-                    auto neighbor = m_chunks.find(coords + glm::ivec3(x, y, z));
-                    if (neighbor != m_chunks.end())
-                    {
-                        neighbor->second->setDirty(true);
-                    }
-                }
-            }
+            return getChunk(m_chunks, coords) == nullptr || neighborsLoaded(coords, !lightOnly);
+        });
+
+        Chunk *c = getChunk(m_chunks, coords);
+        if (c == nullptr)
+            co_return;
+
+        // nothing exposed it yet, updateNearest meshes it once something does
+        if (!lightOnly && !c->isDirty())
+        {
+            c->setComputing(false);
+            co_return;
         }
-    };
 
-    m_processed.for_each(move);
-    m_processed.clear();
+        uint32_t version = c->getVersion();
+        if (!lightOnly)
+            c->setDirty(false);
+        c->setLightDirty(false);
 
-    auto update = [this](std::unique_ptr<ComputeJob> &job) -> void
-    {
+        co_await onWorker(ThreadLanes::Stream, jobPriority(coords, m_ahead), std::vector<glm::ivec3>(1, coords));
+        std::unique_ptr<ComputeJob> job = compute(coords, lightOnly, version);
+        if (job == nullptr)
+            co_return;
+
+        co_await m_mainThread.resume();
         job->transfer();
-    };
 
-    m_updates.for_each(update);
-    m_updates.clear();
+        c = getChunk(m_chunks, coords);
+        if (c != nullptr && lightOnly)
+            c->setComputing(true);
+    }
+}
+
+Task Game::updateChunk(glm::ivec3 coords, bool lightOnly, uint32_t version, ThreadLanes::Work work, int priority)
+{
+    co_await onWorker(work, priority, std::vector<glm::ivec3>(1, coords));
+    std::unique_ptr<ComputeJob> job = compute(coords, lightOnly, version);
+    if (job == nullptr)
+        co_return;
+
+    co_await m_mainThread.resume();
+    job->transfer();
 }
 
-void Game::dirtyChunks(glm::ivec3 center)
+// runs on a worker, the chunk may have been unloaded since and the guard keeps it alive until the job pins it
+std::unique_ptr<ComputeJob> Game::compute(const glm::ivec3 &coords, bool lightOnly, uint32_t version)
 {
-    for (int x = -1; x < 2; x++)
+    Epoch::Guard guard;
+    Chunk *c = m_chunks.get(coords);
+    if (c == nullptr)
+        return nullptr;
+
+    auto job = std::make_unique<ComputeJob>(*c, m_chunks, version, lightOnly);
+    job->execute();
+    return job;
+}
+
+// structure blocks posted after their target chunk generated, targets still in flight are retried next frame
+void Game::placeLateStructures()
+{
+    std::vector<StructureBuffer::Write> late = m_chunkGenerator.takeLateStructures();
+    late.insert(late.end(), m_lateStructures.begin(), m_lateStructures.end());
+    m_lateStructures.clear();
+
+    for (const auto &w : late)
     {
-        for (int y = -1; y < 2; y++)
+        Chunk *c = getChunk(m_chunks, w.target);
+        if (c == nullptr)
         {
-            for (int z = -1; z < 2; z++)
-            {
-                auto neighbor = m_chunks.find(center + glm::ivec3(x, y, z));
-                if (neighbor != m_chunks.end())
-                    neighbor->second->setDirty(true);
-            }
+            if (m_loadedChunks.find(w.target) != m_loadedChunks.end())
+                m_lateStructures.push_back(w);
+            continue;
         }
+
+        if (!StructureBuffer::canReplace(c->getBlock(w.x, w.y, w.z), w.type))
+            continue;
+
+        c->editBlock(w.x, w.y, w.z, w.type);
+        dirtyChunks(w.target, glm::ivec3(w.x, w.y, w.z));
+    }
+}
+
+void Game::dirtyChunks(glm::ivec3 center, glm::ivec3 block)
+{
+    // only face neighbors touching the edited block can change shape, light reaches the rest on its own
+    glm::ivec3 border = glm::ivec3(block.x == CHUNK_SIZE - 1, block.y == CHUNK_SIZE - 1, block.z == CHUNK_SIZE - 1) -
+        glm::ivec3(block.x == 0, block.y == 0, block.z == 0);
+
+    for (int f = 0; f < 6; f++)
+    {
+        const glm::ivec3 &d = Lighting::faceDirs[f];
+        if (d.x * border.x + d.y * border.y + d.z * border.z != 1)
+            continue;
+
+        auto neighbor = m_chunks.find(center + d);
+        if (neighbor != m_chunks.end())
+            neighbor->second->setDirty(true);
     }
 }
 
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <vector>
@@ -12,45 +16,115 @@
 #include "chunkcompare.h"
 #include "common.h"
 #include "computejob.h"
+#include "coroutine.h"
 #include "frustum.h"
 #include "inputmanager.h"
+#include "mainthread.h"
 #include "player.h"
 #include "renderer.h"
-#include "sharedvector.h"
 #include "terraingenerator.h"
-#include "threadpool.h"
+#include "threadlanes.h"
 
 class Game
 {
 public:
-    Game(GLFWwindow *window);
+    Game(GLFWwindow *window, uint64_t seed, const ThreadLanes::Settings &lanes);
 
     void run();
 
 private:
+    enum class GenerationMode
+    {
+        Chunk,
+        Column
+    };
+
+    struct PendingJob
+    {
+        std::shared_ptr<ThreadPool::Handle> handle;
+        ThreadPool *pool;
+        ThreadLanes::Work work;
+    };
+
+    struct BatchEntry
+    {
+        std::vector<glm::ivec3> chunks;
+        ThreadLanes::Work work;
+    };
+
+    // jobs queued for one lane during a pass
+    struct Batch
+    {
+        std::vector<Job> jobs;
+        std::vector<int> priorities;
+        std::vector<BatchEntry> entries;
+    };
+
     int getVoxel(const glm::ivec3 &i);
     int traceRay(glm::vec3 p, glm::vec3 dir, float range, glm::ivec3 &hitNorm, glm::ivec3 &hitIpos);
     bool raycast(glm::vec3 origin, glm::vec3 dir, float range, glm::ivec3 &hit, glm::ivec3 &norm);
     void processInput(float dt);
 
-    void loadNearest(const glm::ivec3 &center, int maxJobs);
-    void updateNearest(const glm::ivec3 &center, int maxJobs);
+    void loadNearest(const glm::ivec3 &center, const glm::ivec3 &ahead, int maxJobs);
+    void loadColumn(const glm::ivec3 &center, const glm::ivec3 &coords, int priority);
+    bool loadPlaceholder(const glm::ivec3 &coords);
+    void insertChunk(std::unique_ptr<Chunk> c);
+    void queueJob(ThreadLanes::Work work, Job job, int priority, const std::vector<glm::ivec3> &chunks);
+    void submitJobs();
+    int jobPriority(const glm::ivec3 &coords, const glm::ivec3 &ahead);
+    void updateJobs(const glm::ivec3 &ahead);
+    bool neighborsLoaded(const glm::ivec3 &coords, bool mesh);
+    void updateNearest(const glm::ivec3 &ahead, int maxJobs);
+    void updateEdits();
     void updateChunks();
 
-    void dirtyChunks(glm::ivec3 center);
+    // continues the coroutine on a worker through the same batches and handles as every other job, so it
+    // follows the player and a cancel destroys it
+    auto onWorker(ThreadLanes::Work work, int priority, std::vector<glm::ivec3> chunks)
+    {
+        return switchTo([this, work, priority, chunks = std::move(chunks)](Resume r) -> void
+        {
+            queueJob(work, std::move(r), priority, chunks);
+        });
+    };
+
+    Task streamChunks(std::vector<std::unique_ptr<Chunk>> chunks, int priority);
+    Task prepareChunk(glm::ivec3 coords);
+    Task updateChunk(glm::ivec3 coords, bool lightOnly, uint32_t version, ThreadLanes::Work work, int priority);
+    std::unique_ptr<ComputeJob> compute(const glm::ivec3 &coords, bool lightOnly, uint32_t version);
+
+    void placeLateStructures();
+    void dirtyChunks(glm::ivec3 center, glm::ivec3 block);
     Chunk *chunkFromWorld(const glm::vec3 &pos);
 
+    // seconds of player movement the job priorities look ahead
+    static constexpr float LOOKAHEAD = 0.5f;
+    // coroutines resumed on the main thread per tick, the rest wait for the next one
+    static const int MAX_RESUMES_PER_TICK = 256;
+    // main thread time per tick for remeshing around player edits, what doesn't fit jumps the interactive queue
+    static constexpr double EDIT_BUDGET = 0.004;
+    static const int EDIT_PRIORITY = std::numeric_limits<int>::min();
+    // seconds a dirty chunk waits for more changes before one job remeshes them all
+    static constexpr double COALESCE_WINDOW = 0.05;
+
     const int m_loadDistance = 2;
+    GenerationMode m_generationMode = GenerationMode::Column;
     float m_eraseDistance;
     float m_viewDistance;
 
     ChunkMap m_chunks;
     std::set<glm::ivec3, ChunkCompare> m_loadedChunks;
-    SharedVector<std::unique_ptr<Chunk>> m_processed;
-    SharedVector<std::unique_ptr<ComputeJob>> m_updates;
     std::vector<glm::ivec3> m_toErase;
+    std::vector<glm::ivec3> m_edits;
+    std::vector<StructureBuffer::Write> m_lateStructures;
+    std::map<glm::ivec3, PendingJob, ChunkCompare> m_jobs;
+    Batch m_batches[ThreadLanes::LANE_AMOUNT];
+    glm::ivec3 m_center;
+    glm::ivec3 m_ahead;
 
-    ThreadPool m_pool;
+    // outlives the lanes, workers still finishing a job may hand their coroutine back
+    MainThread m_mainThread;
+    ThreadLanes m_lanes;
     TerrainGenerator m_chunkGenerator;
 
     Renderer m_renderer;
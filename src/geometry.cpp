@@ -7,8 +7,15 @@
 
 #include "blocks.h"
 
-void Geometry::makeCube(std::vector<float> &vertices, float x, float y, float z, bool faces[6], int type, 
-    float light[6][4], float sunlight[6][4])
+static const int quadIndices[6] = {
+    0, 1, 2, 0, 2, 3
+};
+
+static const int flippedIndices[6] = {
+    0, 1, 3, 3, 1, 2
+};
+
+void Geometry::makeFace(std::vector<float> &vertices, float x, float y, float z, int face, int type, bool flip)
 {
     static const glm::vec3 positions[6][4] = {
         { glm::vec3(-0.5f, -0.5f,  0.5f), glm::vec3(-0.5f,  0.5f,  0.5f), glm::vec3(0.5f,  0.5f,  0.5f), glm::vec3(0.5f, -0.5f,  0.5f) },
@@ -23,39 +30,32 @@ void Geometry::makeCube(std::vector<float> &vertices, float x, float y, float z,
         glm::vec2(0.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec2(1.0f, 1.0f), glm::vec2(1.0f, 0.0f)
     };
 
-    static const int indices[6] = {
-        0, 1, 2, 0, 2, 3
-    };
-
-    static const int flipped[6] = {
-        0, 1, 3, 3, 1, 2
-    };
-
     float s = 1.0f / 16.0f;
 
-    for (int i = 0; i < 6; i++)
-    {
-        if (!faces[i]) continue;
+    int idx = Blocks::faces[type][face];
+    float tu = s * static_cast<float>(idx % 16);
+    float tv = 1.0f - s * static_cast<float>(idx / 16) - s;
 
-        int idx = Blocks::faces[type][i];
-        float tu = s * static_cast<float>(idx % 16);
-        float tv = 1.0f - s * static_cast<float>(idx / 16) - s;
+    for (int v = 0; v < 6; v++)
+    {
+        int j = flip ? flippedIndices[v] : quadIndices[v];
+        vertices.push_back(positions[face][j].x + x);
+        vertices.push_back(positions[face][j].y + y);
+        vertices.push_back(positions[face][j].z + z);
+        vertices.push_back(tu + texcoords[j].x * s);
+        vertices.push_back(tv + texcoords[j].y * s);
+    }
+}
 
-        // https://0fps.net/2013/07/03/ambient-occlusion-for-minecraft-like-worlds/
-        bool flip = light[i][0] + light[i][2] > light[i][1] + light[i][3];
-        for (int v = 0; v < 6; v++)
-        {
-            int j = flip ? flipped[v] : indices[v];
-            vertices.push_back(positions[i][j].x + x);
-            vertices.push_back(positions[i][j].y + y);
-            vertices.push_back(positions[i][j].z + z);
-            vertices.push_back(tu + texcoords[j].x * s);
-            vertices.push_back(tv + texcoords[j].y * s);
-            //int l = std::max(static_cast<float>(light[i][j]), 4.0f);
-            //float lightVal = std::powf(0.8f, 15.0f - l);
-            vertices.push_back(light[i][j] / 16.0f);
-            vertices.push_back(sunlight[i][j] / 16.0f);
-        }
+void Geometry::makeFaceLight(std::vector<float> &lighting, bool flip, float light[4], float sunlight[4])
+{
+    for (int v = 0; v < 6; v++)
+    {
+        int j = flip ? flippedIndices[v] : quadIndices[v];
+        //int l = std::max(static_cast<float>(light[j]), 4.0f);
+        //float lightVal = std::powf(0.8f, 15.0f - l);
+        lighting.push_back(light[j] / 16.0f);
+        lighting.push_back(sunlight[j] / 16.0f);
     }
 }
 
@@ -85,8 +85,7 @@ void Geometry::makeSelectCube(std::vector<float> &vertices, float size)
     }
 }
 
-void Geometry::makePlant(std::vector<float> &vertices, float x, float y, float z, int type, 
-    int light, int sunlight)
+void Geometry::makePlant(std::vector<float> &vertices, float x, float y, float z, int type)
 {
     static const glm::vec3 positions[2][4] = {
         { glm::vec3(0.5f,  0.5f,  0.0f), glm::vec3(0.5f, -0.5f,  0.0f), glm::vec3(-0.5f, -0.5f,  0.0f), glm::vec3(-0.5f,  0.5f,  0.0f) },
@@ -97,10 +96,6 @@ void Geometry::makePlant(std::vector<float> &vertices, float x, float y, float z
         glm::vec2(1.0f, 1.0f), glm::vec2(1.0f, 0.0f), glm::vec2(0.0f, 0.0f), glm::vec2(0.0f, 1.0f)
     };
 
-    static const int indices[6] = {
-        0, 1, 2, 0, 2, 3
-    };
-
     glm::mat4 model;
     model = glm::rotate(model, 45.0f, glm::vec3(0, 1, 0));
 
@@ -112,22 +107,30 @@ void Geometry::makePlant(std::vector<float> &vertices, float x, float y, float z
         float tv = 1.0f - s * static_cast<float>(idx / 16) - s;
         for (int v = 0; v < 6; v++)
         {
-            int j = indices[v];
+            int j = quadIndices[v];
             glm::vec4 pos = model * glm::vec4(positions[i][j], 1.0f);
             vertices.push_back(pos.x + x);
             vertices.push_back(pos.y + y);
             vertices.push_back(pos.z + z);
             vertices.push_back(tu + texcoords[j].x * s);
             vertices.push_back(tv + texcoords[j].y * s);
-            //int l = std::max(static_cast<float>(light), 4.0f);
-            //float lightVal = std::powf(0.8f, 15.0f - l);
-            float lightVal = (static_cast<float>(light) + 1.0f) / 16.0f;
-            vertices.push_back(lightVal);
-            vertices.push_back((static_cast<float>(sunlight) + 1.0f) / 16.0f);
         }
     }
 }
 
+void Geometry::makePlantLight(std::vector<float> &lighting, int light, int sunlight)
+{
+    //int l = std::max(static_cast<float>(light), 4.0f);
+    //float lightVal = std::powf(0.8f, 15.0f - l);
+    float lightVal = (static_cast<float>(light) + 1.0f) / 16.0f;
+    float sunVal = (static_cast<float>(sunlight) + 1.0f) / 16.0f;
+    for (int v = 0; v < 12; v++)
+    {
+        lighting.push_back(lightVal);
+        lighting.push_back(sunVal);
+    }
+}
+
 void Geometry::makeGuiQuad(std::vector<float> &vertices, float xs, float ys)
 {
     static const glm::vec2 positions[4] = {
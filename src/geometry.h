@@ -4,8 +4,10 @@
 
 namespace Geometry
 {
-    void makeCube(std::vector<float> &vertices, float x, float y, float z, bool faces[6], int type, float light[6][4], float sunlight[6][4]);
+    void makeFace(std::vector<float> &vertices, float x, float y, float z, int face, int type, bool flip);
+    void makeFaceLight(std::vector<float> &lighting, bool flip, float light[4], float sunlight[4]);
     void makeSelectCube(std::vector<float> &vertices, float size);
-    void makePlant(std::vector<float> &vertices, float x, float y, float z, int type, int light, int sunlight);
+    void makePlant(std::vector<float> &vertices, float x, float y, float z, int type);
+    void makePlantLight(std::vector<float> &lighting, int light, int sunlight);
     void makeGuiQuad(std::vector<float> &vertices, float xs, float ys);
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// move only replacement for std::function<void()>, callables up to INLINE_SIZE bytes live inside the job so
+// queueing one doesn't touch the heap
+class Job
+{
+public:
+    static const size_t INLINE_SIZE = 48;
+
+    Job() : m_ops(nullptr) {};
+
+    template<typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Job>::value>::type>
+    Job(F &&f);
+
+    Job(Job &&other) noexcept;
+    Job &operator=(Job &&other) noexcept;
+    ~Job();
+
+    Job(const Job&) = delete;
+    Job &operator=(const Job&) = delete;
+
+    void operator()() { m_ops->invoke(m_storage); };
+    explicit operator bool() const { return m_ops != nullptr; };
+
+private:
+    struct Ops
+    {
+        void (*invoke)(void *storage);
+        void (*move)(void *to, void *from);
+        void (*destroy)(void *storage);
+    };
+
+    template<typename F>
+    static constexpr bool fitsInline()
+    {
+        return sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible<F>::value;
+    }
+
+    template<typename F>
+    struct Inline
+    {
+        static void invoke(void *storage) { (*static_cast<F*>(storage))(); };
+        static void move(void *to, void *from)
+        {
+            new (to) F(std::move(*static_cast<F*>(from)));
+            static_cast<F*>(from)->~F();
+        };
+        static void destroy(void *storage) { static_cast<F*>(storage)->~F(); };
+        static constexpr Ops ops = { invoke, move, destroy };
+    };
+
+    // too big or throwing on move, the job keeps a pointer instead
+    template<typename F>
+    struct Boxed
+    {
+        static F *&get(void *storage) { return *static_cast<F**>(storage); };
+        static void invoke(void *storage) { (*get(storage))(); };
+        static void move(void *to, void *from) { new (to) F*(get(from)); };
+        static void destroy(void *storage) { delete get(storage); };
+        static constexpr Ops ops = { invoke, move, destroy };
+    };
+
+    void reset();
+
+    alignas(std::max_align_t) unsigned char m_storage[INLINE_SIZE];
+    const Ops *m_ops;
+};
+
+template<typename F, typename>
+Job::Job(F &&f)
+{
+    typedef typename std::decay<F>::type Callable;
+    if constexpr (fitsInline<Callable>())
+    {
+        new (m_storage) Callable(std::forward<F>(f));
+        m_ops = &Inline<Callable>::ops;
+    }
+    else
+    {
+        new (m_storage) Callable*(new Callable(std::forward<F>(f)));
+        m_ops = &Boxed<Callable>::ops;
+    }
+}
+
+inline Job::Job(Job &&other) noexcept : m_ops(other.m_ops)
+{
+    if (m_ops != nullptr)
+    {
+        m_ops->move(m_storage, other.m_storage);
+        other.m_ops = nullptr;
+    }
+}
+
+inline Job &Job::operator=(Job &&other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        m_ops = other.m_ops;
+        if (m_ops != nullptr)
+        {
+            m_ops->move(m_storage, other.m_storage);
+            other.m_ops = nullptr;
+        }
+    }
+
+    return *this;
+}
+
+inline Job::~Job()
+{
+    reset();
+}
+
+inline void Job::reset()
+{
+    if (m_ops != nullptr)
+    {
+        m_ops->destroy(m_storage);
+        m_ops = nullptr;
+    }
+}
\ No newline at end of file
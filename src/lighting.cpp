@@ -0,0 +1,396 @@
+#include "lighting.h"
+
+#include <algorithm>
+#include <queue>
+
+#include "blocks.h"
+#include "chunk.h"
+
+const glm::ivec3 Lighting::faceDirs[6] = {
+    glm::ivec3(0, 0, 1), glm::ivec3(0, 0, -1), glm::ivec3(-1, 0, 0),
+    glm::ivec3(1, 0, 0), glm::ivec3(0, 1, 0), glm::ivec3(0, -1, 0)
+};
+
+static const int FACE_UP = 4;
+static const int FACE_DOWN = 5;
+
+struct LightContext
+{
+    LightContext(Chunk &c, Lighting::Outbox &o, bool i) : chunk(c), out(o), isolated(i), changed(false) {};
+
+    Chunk &chunk;
+    Lighting::Outbox &out;
+    bool isolated;
+    bool changed;
+    std::queue<Lighting::Node> removals[2];
+    std::queue<Lighting::Node> adds[2];
+};
+
+bool Lighting::Updates::empty() const
+{
+    return adds[Block].empty() && adds[Sun].empty() && removals[Block].empty() && removals[Sun].empty() &&
+        edits.empty() && exports == 0 && !skyRemoval && !reset;
+}
+
+void Lighting::Updates::merge(Updates &other)
+{
+    for (int ch = 0; ch < 2; ch++)
+    {
+        adds[ch].insert(adds[ch].end(), other.adds[ch].begin(), other.adds[ch].end());
+        removals[ch].insert(removals[ch].end(), other.removals[ch].begin(), other.removals[ch].end());
+    }
+    edits.insert(edits.end(), other.edits.begin(), other.edits.end());
+    exports |= other.exports;
+    skyRemoval = skyRemoval || other.skyRemoval;
+    reset = reset || other.reset;
+}
+
+// 0 lets light through, 1 blocks it, 2 lets it through at double cost
+static int lightType(int type)
+{
+    if (Blocks::isLight(type))
+        return 0;
+    if (type == Blocks::Leaves)
+        return 2;
+    if (Blocks::isSolid(type))
+        return 1;
+    return 0;
+}
+
+static bool inside(int x, int y, int z)
+{
+    return x >= 0 && x < CHUNK_SIZE && y >= 0 && y < CHUNK_SIZE && z >= 0 && z < CHUNK_SIZE;
+}
+
+static int getValue(Chunk &c, int ch, int x, int y, int z)
+{
+    return ch == Lighting::Block ? c.getLight(x, y, z) : c.getSunlight(x, y, z);
+}
+
+static void markChanged(LightContext &ctx, int x, int y, int z)
+{
+    ctx.changed = true;
+    if (ctx.isolated)
+        return;
+
+    int ax = x == 0 ? -1 : (x == CHUNK_SIZE - 1 ? 1 : 0);
+    int ay = y == 0 ? -1 : (y == CHUNK_SIZE - 1 ? 1 : 0);
+    int az = z == 0 ? -1 : (z == CHUNK_SIZE - 1 ? 1 : 0);
+    if (ax == 0 && ay == 0 && az == 0)
+        return;
+
+    for (int dx = (std::min)(ax, 0); dx <= (std::max)(ax, 0); dx++)
+    {
+        for (int dy = (std::min)(ay, 0); dy <= (std::max)(ay, 0); dy++)
+        {
+            for (int dz = (std::min)(az, 0); dz <= (std::max)(az, 0); dz++)
+            {
+                if (dx == 0 && dy == 0 && dz == 0)
+                    continue;
+                ctx.out.changed |= 1u << ((dx + 1) * 9 + (dy + 1) * 3 + (dz + 1));
+            }
+        }
+    }
+}
+
+static void setValue(LightContext &ctx, int ch, int x, int y, int z, int val)
+{
+    if (ch == Lighting::Block)
+        ctx.chunk.setLight(x, y, z, val);
+    else
+        ctx.chunk.setSunlight(x, y, z, val);
+    markChanged(ctx, x, y, z);
+}
+
+static void post(LightContext &ctx, int ch, int face, bool removal, int x, int y, int z, int value, uint8_t flags)
+{
+    if (ctx.isolated)
+        return;
+
+    const glm::ivec3 &d = Lighting::faceDirs[face];
+    Lighting::Node node = {
+        static_cast<int8_t>(x - d.x * CHUNK_SIZE), static_cast<int8_t>(y - d.y * CHUNK_SIZE),
+        static_cast<int8_t>(z - d.z * CHUNK_SIZE), static_cast<uint8_t>(value), flags
+    };
+
+    if (removal)
+        ctx.out.faces[face].removals[ch].push_back(node);
+    else
+        ctx.out.faces[face].adds[ch].push_back(node);
+}
+
+static void checkRemoval(LightContext &ctx, int ch, int x, int y, int z, int value, uint8_t flags)
+{
+    int current = getValue(ctx.chunk, ch, x, y, z);
+    if (current == 0)
+        return;
+
+    // full sunlight falls straight down, so a column below a removed one loses it as well
+    bool column = ch == Lighting::Sun && (flags & Lighting::Down) && value == 15;
+    if (current < value || column)
+    {
+        setValue(ctx, ch, x, y, z, 0);
+        ctx.removals[ch].push({ static_cast<int8_t>(x), static_cast<int8_t>(y), static_cast<int8_t>(z),
+            static_cast<uint8_t>(current), 0 });
+    }
+    else
+    {
+        ctx.adds[ch].push({ static_cast<int8_t>(x), static_cast<int8_t>(y), static_cast<int8_t>(z),
+            static_cast<uint8_t>(current), Lighting::Spread });
+    }
+}
+
+static void removeLight(LightContext &ctx, int ch)
+{
+    auto &queue = ctx.removals[ch];
+    while (!queue.empty())
+    {
+        Lighting::Node node = queue.front();
+        queue.pop();
+
+        for (int f = 0; f < 6; f++)
+        {
+            const glm::ivec3 &d = Lighting::faceDirs[f];
+            int x = node.x + d.x,
+                y = node.y + d.y,
+                z = node.z + d.z;
+            uint8_t flags = f == FACE_DOWN ? Lighting::Down : 0;
+
+            if (!inside(x, y, z))
+            {
+                post(ctx, ch, f, true, x, y, z, node.value, flags);
+                continue;
+            }
+
+            checkRemoval(ctx, ch, x, y, z, node.value, flags);
+        }
+    }
+}
+
+static void addLight(LightContext &ctx, int ch)
+{
+    auto &queue = ctx.adds[ch];
+    while (!queue.empty())
+    {
+        Lighting::Node node = queue.front();
+        queue.pop();
+
+        int light = node.value;
+        int type = lightType(ctx.chunk.getBlock(node.x, node.y, node.z));
+        if (node.flags & Lighting::Spread)
+        {
+            light = getValue(ctx.chunk, ch, node.x, node.y, node.z);
+            if (light == 0)
+                continue;
+        }
+        else
+        {
+            if (light < 1 || type == 1)
+                continue;
+            if (getValue(ctx.chunk, ch, node.x, node.y, node.z) >= light)
+                continue;
+            setValue(ctx, ch, node.x, node.y, node.z, light);
+        }
+
+        bool max = ch == Lighting::Sun && light == 15;
+        int next = type == 2 && light > 1 ? light - 2 : light - 1;
+
+        for (int f = 0; f < 6; f++)
+        {
+            int value = f == FACE_DOWN && max ? 15 : next;
+            if (value < 1)
+                continue;
+
+            const glm::ivec3 &d = Lighting::faceDirs[f];
+            int x = node.x + d.x,
+                y = node.y + d.y,
+                z = node.z + d.z;
+
+            if (!inside(x, y, z))
+            {
+                post(ctx, ch, f, false, x, y, z, value, 0);
+                continue;
+            }
+
+            if (getValue(ctx.chunk, ch, x, y, z) >= value)
+                continue;
+
+            queue.push({ static_cast<int8_t>(x), static_cast<int8_t>(y), static_cast<int8_t>(z),
+                static_cast<uint8_t>(value), 0 });
+        }
+    }
+}
+
+static glm::ivec3 facePos(int face, int a, int b)
+{
+    const int M = CHUNK_SIZE - 1;
+    switch (face)
+    {
+    case 0: return glm::ivec3(a, b, M);
+    case 1: return glm::ivec3(a, b, 0);
+    case 2: return glm::ivec3(0, a, b);
+    case 3: return glm::ivec3(M, a, b);
+    case 4: return glm::ivec3(a, M, b);
+    default: return glm::ivec3(a, 0, b);
+    }
+}
+
+static void exportFace(LightContext &ctx, int face)
+{
+    const glm::ivec3 &d = Lighting::faceDirs[face];
+    for (int a = 0; a < CHUNK_SIZE; a++)
+    {
+        for (int b = 0; b < CHUNK_SIZE; b++)
+        {
+            glm::ivec3 p = facePos(face, a, b);
+            int type = lightType(ctx.chunk.getBlock(p.x, p.y, p.z));
+
+            for (int ch = 0; ch < 2; ch++)
+            {
+                int light = getValue(ctx.chunk, ch, p.x, p.y, p.z);
+                if (light == 0)
+                    continue;
+
+                int value = type == 2 && light > 1 ? light - 2 : light - 1;
+                if (ch == Lighting::Sun && face == FACE_DOWN && light == 15)
+                    value = 15;
+                if (value < 1)
+                    continue;
+
+                post(ctx, ch, face, false, p.x + d.x, p.y + d.y, p.z + d.z, value, 0);
+            }
+        }
+    }
+}
+
+bool Lighting::update(Chunk &c, Updates &updates, Outbox &out)
+{
+    // a fresh chunk is lit on its own, onLoaded() exchanges borders once it is in the map
+    LightContext ctx(c, out, updates.reset);
+
+    if (updates.reset && c.isSky())
+    {
+        // all air under open sky, sunlight would flood every voxel anyway
+        for (int x = 0; x < CHUNK_SIZE; x++)
+        {
+            for (int y = 0; y < CHUNK_SIZE; y++)
+            {
+                for (int z = 0; z < CHUNK_SIZE; z++)
+                {
+                    c.setLight(x, y, z, 0);
+                    c.setSunlight(x, y, z, 15);
+                }
+            }
+        }
+
+        c.setOpenSky(true);
+        ctx.changed = true;
+    }
+    else if (updates.reset)
+    {
+        for (int x = 0; x < CHUNK_SIZE; x++)
+        {
+            for (int y = 0; y < CHUNK_SIZE; y++)
+            {
+                for (int z = 0; z < CHUNK_SIZE; z++)
+                {
+                    c.setLight(x, y, z, 0);
+                    c.setSunlight(x, y, z, 0);
+                    if (Blocks::isLight(c.getBlock(x, y, z)))
+                    {
+                        ctx.adds[Block].push({ static_cast<int8_t>(x), static_cast<int8_t>(y),
+                            static_cast<int8_t>(z), 15, 0 });
+                    }
+                }
+            }
+        }
+
+        c.setOpenSky(true);
+        ctx.changed = true;
+    }
+
+    for (const auto &p : updates.edits)
+    {
+        for (int ch = 0; ch < 2; ch++)
+        {
+            int old = getValue(c, ch, p.x, p.y, p.z);
+            if (old != 0)
+                setValue(ctx, ch, p.x, p.y, p.z, 0);
+            ctx.removals[ch].push({ static_cast<int8_t>(p.x), static_cast<int8_t>(p.y),
+                static_cast<int8_t>(p.z), static_cast<uint8_t>(old), 0 });
+        }
+
+        if (Blocks::isLight(c.getBlock(p.x, p.y, p.z)))
+        {
+            ctx.adds[Block].push({ static_cast<int8_t>(p.x), static_cast<int8_t>(p.y),
+                static_cast<int8_t>(p.z), 15, 0 });
+        }
+    }
+
+    if (updates.skyRemoval)
+    {
+        c.setOpenSky(false);
+        for (int x = 0; x < CHUNK_SIZE; x++)
+        {
+            for (int z = 0; z < CHUNK_SIZE; z++)
+                checkRemoval(ctx, Sun, x, CHUNK_SIZE - 1, z, 15, Down);
+        }
+    }
+
+    for (int ch = 0; ch < 2; ch++)
+    {
+        for (const auto &node : updates.removals[ch])
+            checkRemoval(ctx, ch, node.x, node.y, node.z, node.value, node.flags);
+
+        removeLight(ctx, ch);
+
+        // with nothing loaded above, the sky keeps shining into the top layer
+        if (ch == Sun && c.hasOpenSky())
+        {
+            for (int x = 0; x < CHUNK_SIZE; x++)
+            {
+                for (int z = 0; z < CHUNK_SIZE; z++)
+                {
+                    ctx.adds[Sun].push({ static_cast<int8_t>(x), static_cast<int8_t>(CHUNK_SIZE - 1),
+                        static_cast<int8_t>(z), 15, 0 });
+                }
+            }
+        }
+
+        for (const auto &node : updates.adds[ch])
+            ctx.adds[ch].push(node);
+
+        addLight(ctx, ch);
+    }
+
+    for (int f = 0; f < 6; f++)
+    {
+        if (updates.exports & (1 << f))
+            exportFace(ctx, f);
+    }
+
+    return ctx.changed;
+}
+
+void Lighting::onLoaded(Chunk &c, ChunkMap &chunks)
+{
+    for (int f = 0; f < 6; f++)
+    {
+        auto neighbor = chunks.find(c.getCoords() + faceDirs[f]);
+        if (neighbor == chunks.end())
+            continue;
+
+        // each side hands over the light crossing the shared face, and whichever chunk is
+        // below drops the open sky it assumed while its upper neighbor was missing
+        Updates mine, theirs;
+        mine.exports = 1 << f;
+        theirs.exports = 1 << Chunk::opposites[f];
+        if (f == FACE_UP)
+            mine.skyRemoval = true;
+        else if (f == FACE_DOWN)
+            theirs.skyRemoval = true;
+
+        c.postLight(mine);
+        neighbor->second->postLight(theirs);
+    }
+}
\ No newline at end of file
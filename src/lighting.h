@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "common.h"
+
+class Chunk;
+
+namespace Lighting
+{
+    enum Channel
+    {
+        Block,
+        Sun
+    };
+
+    enum NodeFlags
+    {
+        Down = 1,
+        Spread = 2
+    };
+
+    struct Node
+    {
+        int8_t x, y, z;
+        uint8_t value;
+        uint8_t flags;
+    };
+
+    struct Updates
+    {
+        Updates() : exports(0), skyRemoval(false), reset(false) {};
+
+        bool empty() const;
+        void merge(Updates &other);
+
+        std::vector<Node> adds[2];
+        std::vector<Node> removals[2];
+        std::vector<glm::ivec3> edits;
+        uint8_t exports;
+        bool skyRemoval;
+        bool reset;
+    };
+
+    struct Outbox
+    {
+        Outbox() : changed(0) {};
+
+        Updates faces[6];
+        uint32_t changed;
+    };
+
+    extern const glm::ivec3 faceDirs[6];
+
+    bool update(Chunk &c, Updates &updates, Outbox &out);
+    void onLoaded(Chunk &c, ChunkMap &chunks);
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "lockedthreadpool.h"
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+LockedThreadPool::LockedThreadPool(int threads) : m_stop(false), m_jobsPending(0)
+{
+    for (int i = 0; i < std::max(threads, 1); i++)
+    {
+        m_workers.push_back(std::thread(&LockedThreadPool::getJob, this));
+    }
+}
+
+LockedThreadPool::~LockedThreadPool()
+{
+    m_stop = true;
+    m_cond.notify_all();
+
+    for (int i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i].join();
+    }  
+}
+
+void LockedThreadPool::addJob(std::function<void()> job)
+{
+    m_jobsPending++;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queue.push(job);
+    lock.unlock();
+    m_cond.notify_one();
+}
+
+void LockedThreadPool::waitUntilCompleted()
+{
+    std::unique_lock<std::mutex> lock(m_finishMutex);
+    m_finishCond.wait(lock, [this] { return m_jobsPending <= 0; });
+}
+
+int LockedThreadPool::getJobsAmount()
+{
+    return m_jobsPending;
+}
+
+int LockedThreadPool::getWorkerAmount()
+{
+    return m_workers.size();
+}
+
+void LockedThreadPool::getJob()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_cond.wait(lock, [this] {return !m_queue.empty() || m_stop; });
+
+        if (m_stop)
+            return;
+
+        std::function<void()> job = m_queue.front();
+        m_queue.pop();
+        lock.unlock();
+
+        job();
+        if (--m_jobsPending == 0)
+        {
+            std::lock_guard<std::mutex> finishLock(m_finishMutex);
+            m_finishCond.notify_all();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// the original single queue pool, kept as the baseline for the pool benchmark
+class LockedThreadPool
+{
+public:
+    LockedThreadPool(int threads = std::thread::hardware_concurrency());
+    ~LockedThreadPool();
+
+    void addJob(std::function<void()> job);
+    void waitUntilCompleted();
+    int getJobsAmount();
+    int getWorkerAmount();
+
+private:
+    void getJob();
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+
+    std::atomic<int> m_jobsPending;
+    std::mutex m_finishMutex;
+    std::condition_variable m_finishCond;
+    bool m_stop;
+};
\ No newline at end of file
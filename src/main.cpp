@@ -1,17 +1,82 @@
 #include <iostream>
 #include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "chunkmapstress.h"
 #include "game.h"
+#include "poolbenchmark.h"
+#include "pregenerator.h"
+#include "threadlanes.h"
 
 static void framebufferSizeCallback(GLFWwindow *window, int width, int height);
 static void windowFocusCallback(GLFWwindow *window, int focused);
 static void getResolution(int &width, int &height);
 
-int main()
+int main(int argc, char **argv)
 {
+    uint64_t seed = 0;
+    bool pregen = false;
+    int region[4] = {};
+    std::string outDir = "pregen";
+    ThreadLanes::Settings lanes = ThreadLanes::defaults();
+    ThreadLanes::Lane lane;
+    ThreadLanes::Work work;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--pregen") == 0 && i + 4 < argc)
+        {
+            pregen = true;
+            for (int j = 0; j < 4; j++)
+                region[j] = std::atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outDir = argv[++i];
+        // --threads bulk 6, --cpus bulk fc (hex), --nice bulk 10, --route update interactive
+        else if (strcmp(argv[i], "--threads") == 0 && i + 2 < argc && ThreadLanes::parseLane(argv[++i], lane))
+            lanes.lanes[lane].threads = std::atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cpus") == 0 && i + 2 < argc && ThreadLanes::parseLane(argv[++i], lane))
+            lanes.lanes[lane].affinity = std::strtoull(argv[++i], nullptr, 16);
+        else if (strcmp(argv[i], "--nice") == 0 && i + 2 < argc && ThreadLanes::parseLane(argv[++i], lane))
+            lanes.lanes[lane].nice = std::atoi(argv[++i]);
+        else if (strcmp(argv[i], "--route") == 0 && i + 2 < argc && ThreadLanes::parseWork(argv[++i], work) &&
+            ThreadLanes::parseLane(argv[++i], lane))
+            lanes.routes[work] = lane;
+        else if (strcmp(argv[i], "--no-reserve") == 0)
+            lanes.reserveMain = false;
+        else if (strcmp(argv[i], "--bench-pool") == 0)
+        {
+            PoolBenchmark::run();
+            return 0;
+        }
+        else if (strcmp(argv[i], "--stress-pipeline") == 0)
+        {
+            ChunkMapStress::runPipeline(i + 1 < argc ? std::atoi(argv[i + 1]) : 10);
+            return 0;
+        }
+        else if (strcmp(argv[i], "--stress-map") == 0)
+        {
+            ChunkMapStress::run(i + 1 < argc ? std::atoi(argv[i + 1]) : 10);
+            return 0;
+        }
+    }
+
+    // --pregen x0 z0 x1 z1 runs headless over that rectangle of chunk columns and exits
+    if (pregen)
+    {
+        std::cout << "seed " << seed << std::endl;
+        Pregenerator pregenerator(seed, outDir, lanes);
+        pregenerator.run(region[0], region[1], region[2], region[3]);
+        return 0;
+    }
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -42,7 +107,8 @@ int main()
         return -1;
     }
 
-    Game game(window);
+    std::cout << "seed " << seed << std::endl;
+    Game game(window, seed, lanes);
     game.run();
 
     glfwDestroyWindow(window);
@@ -0,0 +1,32 @@
+#include "mainthread.h"
+
+#include <limits>
+#include <utility>
+
+// coroutines still on their way here are dropped like a cancelled job's
+MainThread::~MainThread()
+{
+    m_queue.drain(std::numeric_limits<size_t>::max(), [](Sent *s) -> void
+    {
+        s->handle.destroy();
+    });
+}
+
+void MainThread::run(size_t max)
+{
+    m_queue.drain(max, [](Sent *s) -> void
+    {
+        s->handle.resume();
+    });
+
+    // resuming can add new waiters, those get their first check next run
+    std::vector<Waiting> waiting;
+    std::swap(waiting, m_waiting);
+    for (auto &w : waiting)
+    {
+        if (w.ready())
+            w.resume();
+        else
+            m_waiting.push_back(std::move(w));
+    }
+}
\ No newline at end of file
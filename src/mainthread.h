@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "coroutine.h"
+#include "mpscqueue.h"
+
+// resumes coroutines on the thread that calls run(), any thread can send one here and the main thread can
+// also park one until a condition holds
+class MainThread
+{
+public:
+    ~MainThread();
+
+    auto resume()
+    {
+        return Sent{ {}, *this, nullptr };
+    };
+
+    // main thread only, the condition is checked on every run() until it holds
+    auto until(std::function<bool()> ready)
+    {
+        struct Awaiter
+        {
+            MainThread &main;
+            std::function<bool()> ready;
+
+            bool await_ready() { return ready(); };
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                main.m_waiting.push_back({ std::move(ready), Resume(handle) });
+            };
+            void await_resume() {};
+        };
+
+        return Awaiter{ *this, std::move(ready) };
+    };
+
+    // resumes at most max coroutines that were sent here, then every waiting one whose condition holds
+    void run(size_t max);
+    size_t getWaitingAmount() const { return m_waiting.size(); };
+
+private:
+    // lives in the suspended coroutine's frame, so sending one here doesn't allocate
+    struct Sent : MpscNode
+    {
+        MainThread &main;
+        std::coroutine_handle<> handle;
+
+        bool await_ready() { return false; };
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            // the main thread may resume the coroutine before push returns, nothing here is touched after
+            handle = h;
+            main.m_queue.push(this);
+        };
+        void await_resume() {};
+    };
+
+    struct Waiting
+    {
+        std::function<bool()> ready;
+        Resume resume;
+    };
+
+    MpscQueue<Sent> m_queue;
+    std::vector<Waiting> m_waiting;
+};
\ No newline at end of file
@@ -8,26 +8,23 @@ Mesh::Mesh() : m_vertexCount(0)
 }
 
 Mesh::Mesh(const std::vector<float> &data, const std::vector<int> &vertexAttribs, 
-    bool tris, bool staticDraw)
+    bool tris, bool staticDraw) : Mesh(std::vector<std::vector<int>>{ vertexAttribs }, tris, staticDraw)
+{
+    updateData(data);
+}
+
+Mesh::Mesh(const std::vector<std::vector<int>> &streams, bool tris, bool staticDraw) : m_vertexCount(0)
 {
-    m_vertexSize = std::accumulate(vertexAttribs.begin(), vertexAttribs.end(), 0);
-    m_vertexCount = data.size() / m_vertexSize;
     m_shapeMode = tris ? GL_TRIANGLES : GL_LINES;
     m_dataType = staticDraw ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
 
     glGenVertexArrays(1, &m_vao);
     glBindVertexArray(m_vao);
 
-    glGenBuffers(1, &m_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), m_dataType);
-    GLsizei stride = m_vertexSize * sizeof(float);
-    int ptr = 0;
-    for (int i = 0; i < vertexAttribs.size(); i++)
+    int location = 0;
+    for (const auto &attribs : streams)
     {
-        glVertexAttribPointer(i, vertexAttribs[i], GL_FLOAT, GL_FALSE, stride, (void*)(ptr * sizeof(float)));
-        glEnableVertexAttribArray(i);
-        ptr += vertexAttribs[i];
+        addStream(attribs, location);
     }
 
     glBindVertexArray(0);
@@ -36,7 +33,28 @@ Mesh::Mesh(const std::vector<float> &data, const std::vector<int> &vertexAttribs
 Mesh::~Mesh()
 {
     glDeleteVertexArrays(1, &m_vao);
-    glDeleteBuffers(1, &m_vbo);
+    glDeleteBuffers(static_cast<GLsizei>(m_vbos.size()), m_vbos.data());
+}
+
+void Mesh::addStream(const std::vector<int> &vertexAttribs, int &location)
+{
+    GLuint vbo;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    int vertexSize = std::accumulate(vertexAttribs.begin(), vertexAttribs.end(), 0);
+    GLsizei stride = vertexSize * sizeof(float);
+    int ptr = 0;
+    for (int i = 0; i < vertexAttribs.size(); i++)
+    {
+        glVertexAttribPointer(location, vertexAttribs[i], GL_FLOAT, GL_FALSE, stride, (void*)(ptr * sizeof(float)));
+        glEnableVertexAttribArray(location);
+        ptr += vertexAttribs[i];
+        location++;
+    }
+
+    m_vbos.push_back(vbo);
+    m_streamSizes.push_back(vertexSize);
 }
 
 void Mesh::draw()
@@ -47,7 +65,13 @@ void Mesh::draw()
 
 void Mesh::updateData(const std::vector<float> &data)
 {
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    updateStream(0, data);
+}
+
+void Mesh::updateStream(int stream, const std::vector<float> &data)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbos[stream]);
     glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), m_dataType);
-    m_vertexCount = data.size() / m_vertexSize;
+    if (stream == 0)
+        m_vertexCount = data.size() / m_streamSizes[0];
 }
\ No newline at end of file
@@ -10,16 +10,20 @@ public:
     Mesh();
     Mesh(const std::vector<float> &data, const std::vector<int> &vertexAttribs, 
          bool tris, bool staticDraw = true);
+    Mesh(const std::vector<std::vector<int>> &streams, bool tris, bool staticDraw = true);
     ~Mesh();
 
     void draw();
     void updateData(const std::vector<float> &data);
+    void updateStream(int stream, const std::vector<float> &data);
 
 private:
+    void addStream(const std::vector<int> &vertexAttribs, int &location);
+
     GLuint m_vao;
-    GLuint m_vbo;
+    std::vector<GLuint> m_vbos;
+    std::vector<int> m_streamSizes;
     int m_vertexCount;
-    int m_vertexSize;
     GLenum m_shapeMode;
     GLenum m_dataType;
-}; 
\ No newline at end of file
+};
\ No newline at end of file
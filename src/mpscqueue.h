@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// the link a queued item carries, so a push never allocates
+struct MpscNode
+{
+    std::atomic<MpscNode*> next{ nullptr };
+};
+
+// unbounded intrusive multi producer single consumer queue of items deriving from MpscNode. a push is one
+// exchange and one store, so producers never wait on each other or on the consumer. a producer caught between
+// the two only hides its own item, and whatever follows it, from the consumer until it finishes. the queue
+// doesn't own the items and an item can be in one queue at a time
+template<typename T>
+class MpscQueue
+{
+public:
+    MpscQueue();
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue &operator=(const MpscQueue&) = delete;
+
+    void push(T *item);
+    T *pop();
+    // consumer only, hands at most max items to func and returns how many it handed over
+    template<typename F>
+    size_t drain(size_t max, F &&func);
+
+private:
+    void link(MpscNode *node);
+
+    std::atomic<MpscNode*> m_head;
+    // the consumer's side, the oldest item or the stub
+    MpscNode *m_tail;
+    // stands in when the queue runs empty so the last item can still be popped
+    MpscNode m_stub;
+};
+
+template<typename T>
+MpscQueue<T>::MpscQueue() : m_head(&m_stub), m_tail(&m_stub)
+{
+
+}
+
+template<typename T>
+void MpscQueue<T>::link(MpscNode *node)
+{
+    node->next.store(nullptr, std::memory_order_relaxed);
+    MpscNode *prev = m_head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+}
+
+template<typename T>
+void MpscQueue<T>::push(T *item)
+{
+    link(static_cast<MpscNode*>(item));
+}
+
+template<typename T>
+T *MpscQueue<T>::pop()
+{
+    MpscNode *tail = m_tail;
+    MpscNode *next = tail->next.load(std::memory_order_acquire);
+    if (tail == &m_stub)
+    {
+        if (next == nullptr)
+            return nullptr;
+
+        m_tail = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next != nullptr)
+    {
+        m_tail = next;
+        return static_cast<T*>(tail);
+    }
+
+    // a producer is between its exchange and its store
+    if (tail != m_head.load(std::memory_order_acquire))
+        return nullptr;
+
+    // tail is the last item, the stub goes behind it so it can be unlinked
+    link(&m_stub);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next == nullptr)
+        return nullptr;
+
+    m_tail = next;
+    return static_cast<T*>(tail);
+}
+
+template<typename T>
+template<typename F>
+size_t MpscQueue<T>::drain(size_t max, F &&func)
+{
+    size_t n = 0;
+    while (n < max)
+    {
+        T *item = pop();
+        if (item == nullptr)
+            break;
+
+        func(item);
+        n++;
+    }
+
+    return n;
+}
\ No newline at end of file
@@ -0,0 +1,392 @@
+#include "noisegraph.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include "random.h"
+
+NoiseGraph::NoiseGraph(uint64_t seed) : m_seed(seed)
+{
+
+}
+
+static bool toFloat(const std::string &token, float &value)
+{
+    char *end;
+    value = std::strtof(token.c_str(), &end);
+    return !token.empty() && *end == '\0';
+}
+
+bool NoiseGraph::parse(const std::string &text)
+{
+    std::vector<Node> nodes;
+    std::unordered_map<std::string, int> names;
+
+    std::istringstream lines(text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line))
+    {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream stream(line);
+        std::vector<std::string> tokens;
+        std::string token;
+        while (stream >> token)
+            tokens.push_back(token);
+
+        if (tokens.empty())
+            continue;
+
+        auto fail = [lineNumber](const std::string &message) -> bool
+        {
+            std::cout << "error: noise graph line " << lineNumber << ": " << message << std::endl;
+            return false;
+        };
+
+        if (tokens.size() < 3 || tokens[1] != "=")
+            return fail("expected 'name = op ...'");
+
+        const std::string &name = tokens[0];
+        const std::string &op = tokens[2];
+        std::vector<std::string> args(tokens.begin() + 3, tokens.end());
+
+        Node node;
+        node.w = 0.0f;
+
+        // node names or numbers, numbers become anonymous constants
+        auto operand = [&nodes, &names](const std::string &token, int &index) -> bool
+        {
+            auto it = names.find(token);
+            if (it != names.end())
+            {
+                index = it->second;
+                return true;
+            }
+
+            Node constant;
+            constant.op = Const;
+            constant.w = 0.0f;
+            constant.params.push_back(0.0f);
+            if (!toFloat(token, constant.params[0]))
+                return false;
+
+            index = static_cast<int>(nodes.size());
+            nodes.push_back(std::move(constant));
+            return true;
+        };
+
+        size_t arity = 0;
+        if (op == "const")
+        {
+            node.op = Const;
+            node.params.push_back(0.0f);
+            if (args.size() != 1 || !toFloat(args[0], node.params[0]))
+                return fail("const takes one number");
+        }
+        else if (op == "x" || op == "y" || op == "z")
+        {
+            node.op = op == "x" ? X : (op == "y" ? Y : Z);
+        }
+        else if (op == "perlin")
+        {
+            float octaves = 1, frequency = 1, amplitude = 1, lacunarity = 2, persistence = 0.5f, seed = 0, error = 0;
+            for (const auto &arg : args)
+            {
+                size_t eq = arg.find('=');
+                std::string key = arg.substr(0, eq);
+                float value;
+                if (eq == std::string::npos || !toFloat(arg.substr(eq + 1), value))
+                    return fail("bad perlin parameter " + arg);
+
+                if (key == "octaves") octaves = value;
+                else if (key == "frequency") frequency = value;
+                else if (key == "amplitude") amplitude = value;
+                else if (key == "lacunarity") lacunarity = value;
+                else if (key == "persistence") persistence = value;
+                else if (key == "seed") seed = value;
+                else if (key == "w") node.w = value;
+                else if (key == "error") error = value;
+                else return fail("unknown perlin parameter " + key);
+            }
+
+            node.op = Noise;
+            node.noise = std::make_unique<Perlin>(static_cast<int>(octaves), frequency, amplitude, lacunarity,
+                persistence, Random::hash(m_seed, static_cast<int>(seed), 0, 0));
+            node.sampler = std::make_unique<NoiseSampler>(*node.noise, error);
+        }
+        else if (op == "add" || op == "mul")
+        {
+            node.op = op == "add" ? Add : Mul;
+            arity = 2;
+        }
+        else if (op == "clamp")
+        {
+            node.op = Clamp;
+            arity = 3;
+        }
+        else if (op == "select")
+        {
+            node.op = Select;
+            arity = 4;
+        }
+        else if (op == "curve")
+        {
+            node.op = Curve;
+            arity = 1;
+            if (args.size() < 3 || args.size() % 2 == 0)
+                return fail("curve takes an input and x y pairs");
+
+            for (size_t i = 1; i < args.size(); i++)
+            {
+                float value;
+                if (!toFloat(args[i], value))
+                    return fail("curve points must be numbers");
+                node.params.push_back(value);
+            }
+            for (size_t i = 2; i < node.params.size(); i += 2)
+            {
+                if (node.params[i] <= node.params[i - 2])
+                    return fail("curve points must be sorted by x");
+            }
+            args.resize(1);
+        }
+        else
+        {
+            return fail("unknown op " + op);
+        }
+
+        if (arity == 0 && node.op != Const && node.op != Noise && !args.empty())
+            return fail(op + " takes no operands");
+        if (arity != 0 && args.size() != arity)
+            return fail(op + " takes " + std::to_string(arity) + " operands");
+
+        for (size_t i = 0; i < arity; i++)
+        {
+            const std::string &arg = args[i];
+            int index;
+            if (!operand(arg, index))
+                return fail("unknown node " + arg);
+            node.inputs.push_back(index);
+        }
+
+        names[name] = static_cast<int>(nodes.size());
+        nodes.push_back(std::move(node));
+    }
+
+    m_nodes = std::move(nodes);
+    m_names = std::move(names);
+    return true;
+}
+
+NoiseGraph::Program NoiseGraph::compile(const std::string &output) const
+{
+    Program program;
+    auto it = m_names.find(output);
+    if (it == m_names.end())
+        return program;
+
+    // nodes only reference earlier ones, so definition order is already an evaluation order
+    std::vector<bool> needed(it->second + 1, false);
+    needed[it->second] = true;
+    for (int i = it->second; i >= 0; i--)
+    {
+        if (!needed[i])
+            continue;
+        for (int input : m_nodes[i].inputs)
+            needed[input] = true;
+    }
+
+    std::vector<int> stepOf(needed.size(), -1);
+    for (int i = 0; i <= it->second; i++)
+    {
+        if (!needed[i])
+            continue;
+
+        Step step;
+        step.node = i;
+        for (int k = 0; k < 4; k++)
+            step.inputs[k] = k < static_cast<int>(m_nodes[i].inputs.size()) ? stepOf[m_nodes[i].inputs[k]] : -1;
+
+        stepOf[i] = static_cast<int>(program.steps.size());
+        program.steps.push_back(step);
+    }
+
+    return program;
+}
+
+void NoiseGraph::evaluate2D(const Program &program, int x0, int z0, float *out) const
+{
+    evaluate(program, 2, glm::ivec3(x0, 0, z0), out);
+}
+
+void NoiseGraph::evaluate3D(const Program &program, int x0, int y0, int z0, float *out) const
+{
+    evaluate(program, 3, glm::ivec3(x0, y0, z0), out);
+}
+
+static float curve(const std::vector<float> &points, float v)
+{
+    size_t n = points.size();
+    if (v <= points[0])
+        return points[1];
+    if (v >= points[n - 2])
+        return points[n - 1];
+
+    size_t i = 2;
+    while (points[i] < v)
+        i += 2;
+
+    float t = (v - points[i - 2]) / (points[i] - points[i - 2]);
+    return points[i - 1] + t * (points[i + 1] - points[i - 1]);
+}
+
+// every node runs as one tight loop over the whole tile
+void NoiseGraph::evaluate(const Program &program, int dimensions, glm::ivec3 origin, float *out) const
+{
+    const int size = dimensions == 2 ? TILE * TILE : TILE * TILE * TILE;
+    const int last = static_cast<int>(program.steps.size()) - 1;
+    if (last < 0)
+        return;
+
+    std::vector<float> buffers(static_cast<size_t>(last) * size);
+    auto buffer = [&buffers, &out, size, last](int step) -> float*
+    {
+        return step == last ? out : &buffers[static_cast<size_t>(step) * size];
+    };
+
+    for (int s = 0; s <= last; s++)
+    {
+        const Step &step = program.steps[s];
+        const Node &node = m_nodes[step.node];
+        float *dst = buffer(s);
+        const float *a = step.inputs[0] >= 0 ? buffer(step.inputs[0]) : nullptr;
+        const float *b = step.inputs[1] >= 0 ? buffer(step.inputs[1]) : nullptr;
+        const float *c = step.inputs[2] >= 0 ? buffer(step.inputs[2]) : nullptr;
+        const float *d = step.inputs[3] >= 0 ? buffer(step.inputs[3]) : nullptr;
+
+        switch (node.op)
+        {
+        case Const:
+            std::fill(dst, dst + size, node.params[0]);
+            break;
+        case X:
+        case Y:
+        case Z:
+            for (int i = 0; i < size; i++)
+            {
+                int x = dimensions == 2 ? i / TILE : i / (TILE * TILE);
+                int y = dimensions == 2 ? 0 : (i / TILE) % TILE;
+                int z = i % TILE;
+                glm::ivec3 p = origin + glm::ivec3(x, y, z);
+                dst[i] = static_cast<float>(node.op == X ? p.x : (node.op == Y ? p.y : p.z));
+            }
+            break;
+        case Noise:
+            if (dimensions == 2)
+                node.sampler->sample2D(origin.x, origin.z, node.w, TILE, dst);
+            else
+                node.sampler->sample3D(origin.x, origin.y, origin.z, TILE, dst);
+            break;
+        case Add:
+            for (int i = 0; i < size; i++)
+                dst[i] = a[i] + b[i];
+            break;
+        case Mul:
+            for (int i = 0; i < size; i++)
+                dst[i] = a[i] * b[i];
+            break;
+        case Clamp:
+            for (int i = 0; i < size; i++)
+                dst[i] = (std::min)((std::max)(a[i], b[i]), c[i]);
+            break;
+        case Select:
+            for (int i = 0; i < size; i++)
+                dst[i] = a[i] < b[i] ? c[i] : d[i];
+            break;
+        case Curve:
+            for (int i = 0; i < size; i++)
+                dst[i] = curve(node.params, a[i]);
+            break;
+        }
+    }
+}
+
+// interval arithmetic over the same program, min and max are the corners of the sampled region
+NoiseGraph::Interval NoiseGraph::bounds(const Program &program, const glm::vec3 &min, const glm::vec3 &max) const
+{
+    std::vector<Interval> values(program.steps.size());
+
+    for (size_t s = 0; s < program.steps.size(); s++)
+    {
+        const Step &step = program.steps[s];
+        const Node &node = m_nodes[step.node];
+        Interval in[4];
+        for (int k = 0; k < 4; k++)
+            in[k] = step.inputs[k] >= 0 ? values[step.inputs[k]] : Interval{ 0.0f, 0.0f };
+
+        Interval &v = values[s];
+        switch (node.op)
+        {
+        case Const:
+            v = { node.params[0], node.params[0] };
+            break;
+        case X:
+            v = { min.x, max.x };
+            break;
+        case Y:
+            v = { min.y, max.y };
+            break;
+        case Z:
+            v = { min.z, max.z };
+            break;
+        case Noise:
+        {
+            float range = static_cast<float>(node.noise->range());
+            v = { -range, range };
+            break;
+        }
+        case Add:
+            v = { in[0].min + in[1].min, in[0].max + in[1].max };
+            break;
+        case Mul:
+        {
+            float p[4] = { in[0].min * in[1].min, in[0].min * in[1].max, in[0].max * in[1].min, in[0].max * in[1].max };
+            v = { *std::min_element(p, p + 4), *std::max_element(p, p + 4) };
+            break;
+        }
+        case Clamp:
+            v = { (std::min)((std::max)(in[0].min, in[1].min), in[2].min),
+                (std::min)((std::max)(in[0].max, in[1].max), in[2].max) };
+            break;
+        case Select:
+            if (in[0].max < in[1].min)
+                v = in[2];
+            else if (in[0].min >= in[1].max)
+                v = in[3];
+            else
+                v = { (std::min)(in[2].min, in[3].min), (std::max)(in[2].max, in[3].max) };
+            break;
+        case Curve:
+        {
+            float lo = curve(node.params, in[0].min);
+            float hi = curve(node.params, in[0].max);
+            v = { (std::min)(lo, hi), (std::max)(lo, hi) };
+            for (size_t i = 0; i < node.params.size(); i += 2)
+            {
+                if (node.params[i] > in[0].min && node.params[i] < in[0].max)
+                {
+                    v.min = (std::min)(v.min, node.params[i + 1]);
+                    v.max = (std::max)(v.max, node.params[i + 1]);
+                }
+            }
+            break;
+        }
+        }
+    }
+
+    return values.empty() ? Interval{ 0.0f, 0.0f } : values.back();
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "noisesampler.h"
+#include "perlin.h"
+
+// A small terrain description language, one node per line:
+//
+//   name = perlin octaves=2 frequency=0.02 amplitude=10 lacunarity=2 persistence=0.5 seed=1 w=0.5 error=1
+//   name = const 4 | x | y | z
+//   name = add a b | mul a b | clamp a lo hi
+//   name = select c t below above          c < t ? below : above
+//   name = curve a x0 y0 x1 y1 ...         piecewise linear, flat outside the points
+//
+// Operands are earlier node names or numbers. Tiles are 16x16 columns (perlin samples x, z, w and y is 0)
+// or 16^3 blocks (perlin samples x, y, z).
+class NoiseGraph
+{
+public:
+    static const int TILE = 16;
+
+    struct Interval
+    {
+        float min;
+        float max;
+    };
+
+    struct Step
+    {
+        int node;
+        int inputs[4];
+    };
+
+    struct Program
+    {
+        std::vector<Step> steps;
+
+        bool valid() const { return !steps.empty(); };
+    };
+
+    NoiseGraph(uint64_t seed);
+
+    bool parse(const std::string &text);
+
+    Program compile(const std::string &output) const;
+
+    // out[x * TILE + z]
+    void evaluate2D(const Program &program, int x0, int z0, float *out) const;
+    // out[(x * TILE + y) * TILE + z]
+    void evaluate3D(const Program &program, int x0, int y0, int z0, float *out) const;
+    Interval bounds(const Program &program, const glm::vec3 &min, const glm::vec3 &max) const;
+
+private:
+    enum Op
+    {
+        Const,
+        X,
+        Y,
+        Z,
+        Noise,
+        Add,
+        Mul,
+        Clamp,
+        Select,
+        Curve
+    };
+
+    struct Node
+    {
+        Op op;
+        std::vector<int> inputs;
+        std::vector<float> params;
+        float w;
+        std::unique_ptr<Perlin> noise;
+        std::unique_ptr<NoiseSampler> sampler;
+    };
+
+    void evaluate(const Program &program, int dimensions, glm::ivec3 origin, float *out) const;
+
+    uint64_t m_seed;
+    std::vector<Node> m_nodes;
+    std::unordered_map<std::string, int> m_names;
+};
\ No newline at end of file
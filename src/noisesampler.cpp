@@ -0,0 +1,125 @@
+#include "noisesampler.h"
+
+#include <vector>
+
+NoiseSampler::NoiseSampler(Perlin &noise, float maxError) :
+    m_noise(noise), m_maxError(maxError), m_curvature(noise.curvature())
+{
+
+}
+
+// linear interpolation between lattice points is off by at most step^2 / 8 * |f''| per axis
+int NoiseSampler::getStep(int dimensions, int size) const
+{
+    int step = MAX_STEP;
+    while (step > 1)
+    {
+        double error = step * step / 8.0 * dimensions * m_curvature;
+        if (size % step == 0 && error <= m_maxError)
+            break;
+        step /= 2;
+    }
+    return step;
+}
+
+void NoiseSampler::sample2D(int x0, int y0, float z, int size, float *out)
+{
+    int step = getStep(2, size);
+    int n = step == 1 ? size : size / step + 1;
+    int count = n * n;
+
+    std::vector<float> xs(count), ys(count), zs(count, z);
+    for (int a = 0; a < n; a++)
+    {
+        for (int b = 0; b < n; b++)
+        {
+            xs[a * n + b] = static_cast<float>(x0 + a * step);
+            ys[a * n + b] = static_cast<float>(y0 + b * step);
+        }
+    }
+
+    if (step == 1)
+    {
+        m_noise.perlin3(xs.data(), ys.data(), zs.data(), out, count);
+        return;
+    }
+
+    std::vector<float> lattice(count);
+    m_noise.perlin3(xs.data(), ys.data(), zs.data(), lattice.data(), count);
+
+    float inv = 1.0f / step;
+    for (int x = 0; x < size; x++)
+    {
+        int a = x / step;
+        float fa = (x % step) * inv;
+        const float *l0 = &lattice[a * n];
+        const float *l1 = l0 + n;
+        for (int y = 0; y < size; y++)
+        {
+            int b = y / step;
+            float fb = (y % step) * inv;
+            float v0 = l0[b] + fb * (l0[b + 1] - l0[b]);
+            float v1 = l1[b] + fb * (l1[b + 1] - l1[b]);
+            out[x * size + y] = v0 + fa * (v1 - v0);
+        }
+    }
+}
+
+void NoiseSampler::sample3D(int x0, int y0, int z0, int size, float *out)
+{
+    int step = getStep(3, size);
+    int n = step == 1 ? size : size / step + 1;
+    int count = n * n * n;
+
+    std::vector<float> xs(count), ys(count), zs(count);
+    for (int a = 0; a < n; a++)
+    {
+        for (int b = 0; b < n; b++)
+        {
+            for (int c = 0; c < n; c++)
+            {
+                int i = (a * n + b) * n + c;
+                xs[i] = static_cast<float>(x0 + a * step);
+                ys[i] = static_cast<float>(y0 + b * step);
+                zs[i] = static_cast<float>(z0 + c * step);
+            }
+        }
+    }
+
+    if (step == 1)
+    {
+        m_noise.perlin3(xs.data(), ys.data(), zs.data(), out, count);
+        return;
+    }
+
+    std::vector<float> lattice(count);
+    m_noise.perlin3(xs.data(), ys.data(), zs.data(), lattice.data(), count);
+
+    float inv = 1.0f / step;
+    for (int x = 0; x < size; x++)
+    {
+        int a = x / step;
+        float fa = (x % step) * inv;
+        for (int y = 0; y < size; y++)
+        {
+            int b = y / step;
+            float fb = (y % step) * inv;
+            const float *l00 = &lattice[(a * n + b) * n];
+            const float *l01 = l00 + n;
+            const float *l10 = l00 + n * n;
+            const float *l11 = l10 + n;
+            for (int z = 0; z < size; z++)
+            {
+                int c = z / step;
+                float fc = (z % step) * inv;
+                float v00 = l00[c] + fc * (l00[c + 1] - l00[c]);
+                float v01 = l01[c] + fc * (l01[c + 1] - l01[c]);
+                float v10 = l10[c] + fc * (l10[c + 1] - l10[c]);
+                float v11 = l11[c] + fc * (l11[c + 1] - l11[c]);
+                float v0 = v00 + fb * (v01 - v00);
+                float v1 = v10 + fb * (v11 - v10);
+                out[(x * size + y) * size + z] = v0 + fa * (v1 - v0);
+            }
+        }
+    }
+}
\ No newline at end of file
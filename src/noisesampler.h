@@ -0,0 +1,25 @@
+#pragma once
+
+#include "perlin.h"
+
+// Evaluates a Perlin field on a coarse lattice and interpolates in between. The lattice step is the
+// largest one whose worst case interpolation error stays under maxError, maxError = 0 samples every point.
+class NoiseSampler
+{
+public:
+    static const int MAX_STEP = 16;
+
+    NoiseSampler(Perlin &noise, float maxError);
+
+    int getStep(int dimensions, int size) const;
+
+    // out[x * size + y] = perlin3(x0 + x, y0 + y, z)
+    void sample2D(int x0, int y0, float z, int size, float *out);
+    // out[(x * size + y) * size + z] = perlin3(x0 + x, y0 + y, z0 + z)
+    void sample3D(int x0, int y0, int z0, int size, float *out);
+
+private:
+    Perlin &m_noise;
+    float m_maxError;
+    double m_curvature;
+};
\ No newline at end of file
@@ -2,50 +2,70 @@
 
 #include "perlin.h"
 
+#include <algorithm>
 #include <cmath>
 
+#include "random.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// the AVX2 kernel is built for that target on its own and only used on cpus that report it
+#include <immintrin.h>
+#define PERLIN_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#define PERLIN_SSE2
+#endif
+
+static const std::int32_t permutation[256] = {
+    151,160,137,91,90,15,
+    131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
+    190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
+    88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
+    77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,55,46,245,40,244,
+    102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,187,208, 89,18,169,200,196,
+    135,130,116,188,159,86,164,100,109,198,173,186, 3,64,52,217,226,250,124,123,
+    5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,
+    223,183,170,213,119,248,152, 2,44,154,163, 70,221,153,101,155,167, 43,172,9,
+    129,22,39,253, 19,98,108,110,79,113,224,232,178,185, 112,104,218,246,97,228,
+    251,34,242,193,238,210,144,12,191,179,162,241, 81,51,145,235,249,14,239,107,
+    49,192,214, 31,181,199,106,157,184, 84,204,176,115,121,50,45,127, 4,150,254,
+    138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
+};
+
 Perlin::Perlin()
 {
-    m_p = {
-        151,160,137,91,90,15,
-        131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
-        190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
-        88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
-        77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,55,46,245,40,244,
-        102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,187,208, 89,18,169,200,196,
-        135,130,116,188,159,86,164,100,109,198,173,186, 3,64,52,217,226,250,124,123,
-        5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,
-        223,183,170,213,119,248,152, 2,44,154,163, 70,221,153,101,155,167, 43,172,9,
-        129,22,39,253, 19,98,108,110,79,113,224,232,178,185, 112,104,218,246,97,228,
-        251,34,242,193,238,210,144,12,191,179,162,241, 81,51,145,235,249,14,239,107,
-        49,192,214, 31,181,199,106,157,184, 84,204,176,115,121,50,45,127, 4,150,254,
-        138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
-    };
-
-    m_p.insert(m_p.end(), m_p.begin(), m_p.end());
-}
-
-Perlin::Perlin(int octaves, double frequency, double amplitude, double lacunarity, double persistence) :
+    permute(0);
+}
+
+Perlin::Perlin(int octaves, double frequency, double amplitude, double lacunarity, double persistence,
+    std::uint64_t seed) :
     m_octaves(octaves), m_frequency(frequency), m_amplitude(amplitude), m_lacunarity(lacunarity),
     m_persistence(persistence)
 {
-    m_p = {
-        151,160,137,91,90,15,
-        131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
-        190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
-        88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
-        77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,55,46,245,40,244,
-        102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,187,208, 89,18,169,200,196,
-        135,130,116,188,159,86,164,100,109,198,173,186, 3,64,52,217,226,250,124,123,
-        5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,
-        223,183,170,213,119,248,152, 2,44,154,163, 70,221,153,101,155,167, 43,172,9,
-        129,22,39,253, 19,98,108,110,79,113,224,232,178,185, 112,104,218,246,97,228,
-        251,34,242,193,238,210,144,12,191,179,162,241, 81,51,145,235,249,14,239,107,
-        49,192,214, 31,181,199,106,157,184, 84,204,176,115,121,50,45,127, 4,150,254,
-        138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
-    };
-
-    m_p.insert(m_p.end(), m_p.begin(), m_p.end());
+    permute(seed);
+}
+
+// seed 0 keeps Ken Perlin's table, anything else shuffles it
+void Perlin::permute(std::uint64_t seed)
+{
+    std::copy(permutation, permutation + 256, m_p.begin());
+
+    if (seed != 0)
+    {
+        Random::Stream rng(seed, 0, 0, 0);
+        for (int i = 255; i > 0; i--)
+        {
+            int j = static_cast<int>(rng.next() % (i + 1));
+            std::swap(m_p[i], m_p[j]);
+        }
+    }
+
+    std::copy(m_p.begin(), m_p.begin() + 256, m_p.begin() + 256);
 }
 
 double Perlin::perlin3(double x, double y, double z)
@@ -65,6 +85,39 @@ double Perlin::perlin3(double x, double y, double z)
     return total;
 }
 
+// noise3 stays within +-1.1, so this bounds |perlin3|
+double Perlin::range() const
+{
+    double total = 0;
+    double amplitude = m_amplitude;
+
+    for (int i = 0; i < m_octaves; i++)
+    {
+        total += 1.1 * std::abs(amplitude);
+        amplitude *= m_persistence;
+    }
+
+    return total;
+}
+
+// upper bound on |d2f/dx2| along any axis, a single octave of noise3 stays below 12
+double Perlin::curvature() const
+{
+    double total = 0;
+    double frequency = m_frequency;
+    double amplitude = m_amplitude;
+
+    for (int i = 0; i < m_octaves; i++)
+    {
+        total += 12.0 * std::abs(amplitude) * frequency * frequency;
+
+        amplitude *= m_persistence;
+        frequency *= m_lacunarity;
+    }
+
+    return total;
+}
+
 static double fade(double t)
 {
     return t * t * t * (t * (t * 6 - 15) + 10);
@@ -126,4 +179,206 @@ double Perlin::noise3(double x, double y, double z)
                                        grad(m_p[BB + 1], x - 1, y - 1, z - 1))));
     //return (n + 1) / 2;
     return n;
+}
+
+// float versions for the batched path, grad picks the same 12 directions as the switch above without branching
+static float fadef(float t)
+{
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+static float lerpf(float t, float a, float b)
+{
+    return a + t * (b - a);
+}
+
+static float gradf(int hash, float x, float y, float z)
+{
+    int h = hash & 0xF;
+    float u = h < 8 ? x : y;
+    float v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+    return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+float Perlin::noise3f(float x, float y, float z)
+{
+    float fx = std::floor(x);
+    float fy = std::floor(y);
+    float fz = std::floor(z);
+
+    int X = static_cast<int>(fx) & 255;
+    int Y = static_cast<int>(fy) & 255;
+    int Z = static_cast<int>(fz) & 255;
+
+    x -= fx;
+    y -= fy;
+    z -= fz;
+
+    float u = fadef(x);
+    float v = fadef(y);
+    float w = fadef(z);
+
+    const std::int32_t *p = m_p.data();
+    int A = p[X    ] + Y, AA = p[A] + Z, AB = p[A + 1] + Z,
+        B = p[X + 1] + Y, BA = p[B] + Z, BB = p[B + 1] + Z;
+
+    return lerpf(w, lerpf(v, lerpf(u, gradf(p[AA    ], x       , y       , z       ),
+                                      gradf(p[BA    ], x - 1.0f, y       , z       )),
+                             lerpf(u, gradf(p[AB    ], x       , y - 1.0f, z       ),
+                                      gradf(p[BB    ], x - 1.0f, y - 1.0f, z       ))),
+                    lerpf(v, lerpf(u, gradf(p[AA + 1], x       , y       , z - 1.0f),
+                                      gradf(p[BA + 1], x - 1.0f, y       , z - 1.0f)),
+                             lerpf(u, gradf(p[AB + 1], x       , y - 1.0f, z - 1.0f),
+                                      gradf(p[BB + 1], x - 1.0f, y - 1.0f, z - 1.0f))));
+}
+
+#if defined(PERLIN_AVX2)
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+namespace Avx2
+{
+    typedef __m256 vfloat;
+    typedef __m256i vint;
+
+    static const int LANES = 8;
+
+    static inline vfloat vset(float a) { return _mm256_set1_ps(a); }
+    static inline vfloat vload(const float *p) { return _mm256_loadu_ps(p); }
+    static inline void vstore(float *p, vfloat a) { _mm256_storeu_ps(p, a); }
+    static inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+    static inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+    static inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+    static inline vfloat vxor(vfloat a, vfloat b) { return _mm256_xor_ps(a, b); }
+    static inline vfloat vfloor(vfloat a) { return _mm256_floor_ps(a); }
+    static inline vint vtoint(vfloat a) { return _mm256_cvttps_epi32(a); }
+    static inline vfloat vselect(vint mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask)); }
+    static inline vfloat vsign(vint bit, int shift) { return _mm256_castsi256_ps(_mm256_slli_epi32(bit, shift)); }
+    static inline vint iset(int a) { return _mm256_set1_epi32(a); }
+    static inline vint iadd(vint a, vint b) { return _mm256_add_epi32(a, b); }
+    static inline vint iand(vint a, vint b) { return _mm256_and_si256(a, b); }
+    static inline vint ior(vint a, vint b) { return _mm256_or_si256(a, b); }
+    static inline vint ilt(vint a, vint b) { return _mm256_cmpgt_epi32(b, a); }
+    static inline vint ieq(vint a, vint b) { return _mm256_cmpeq_epi32(a, b); }
+    static inline vint gather(const std::int32_t *p, vint idx) { return _mm256_i32gather_epi32(p, idx, 4); }
+
+#include "perlinkernel.h"
+}
+
+#pragma GCC pop_options
+
+static bool hasAvx2()
+{
+    static const bool avx2 = []() -> bool
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }();
+    return avx2;
+}
+
+#endif
+
+#if defined(PERLIN_SSE2)
+
+namespace Sse2
+{
+    typedef __m128 vfloat;
+    typedef __m128i vint;
+
+    static const int LANES = 4;
+
+    static inline vfloat vset(float a) { return _mm_set1_ps(a); }
+    static inline vfloat vload(const float *p) { return _mm_loadu_ps(p); }
+    static inline void vstore(float *p, vfloat a) { _mm_storeu_ps(p, a); }
+    static inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+    static inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+    static inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+    static inline vfloat vxor(vfloat a, vfloat b) { return _mm_xor_ps(a, b); }
+    static inline vint vtoint(vfloat a) { return _mm_cvttps_epi32(a); }
+    static inline vfloat vsign(vint bit, int shift) { return _mm_castsi128_ps(_mm_slli_epi32(bit, shift)); }
+    static inline vint iset(int a) { return _mm_set1_epi32(a); }
+    static inline vint iadd(vint a, vint b) { return _mm_add_epi32(a, b); }
+    static inline vint iand(vint a, vint b) { return _mm_and_si128(a, b); }
+    static inline vint ior(vint a, vint b) { return _mm_or_si128(a, b); }
+    static inline vint ilt(vint a, vint b) { return _mm_cmplt_epi32(a, b); }
+    static inline vint ieq(vint a, vint b) { return _mm_cmpeq_epi32(a, b); }
+
+    static inline vfloat vselect(vint mask, vfloat a, vfloat b)
+    {
+        vfloat m = _mm_castsi128_ps(mask);
+        return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+    }
+
+    static inline vfloat vfloor(vfloat a)
+    {
+#if defined(__SSE4_1__)
+        return _mm_floor_ps(a);
+#else
+        vfloat t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+        return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+#endif
+    }
+
+    static inline vint gather(const std::int32_t *p, vint idx)
+    {
+        alignas(16) std::int32_t i[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(i), idx);
+        return _mm_setr_epi32(p[i[0]], p[i[1]], p[i[2]], p[i[3]]);
+    }
+
+#include "perlinkernel.h"
+}
+
+#endif
+
+void Perlin::noise3(const float *x, const float *y, const float *z, float *out, int count)
+{
+    int i = 0;
+#if defined(PERLIN_AVX2)
+    if (hasAvx2())
+        i = Avx2::noise3(m_p.data(), x, y, z, out, count);
+#endif
+#if defined(PERLIN_SSE2)
+    i += Sse2::noise3(m_p.data(), x + i, y + i, z + i, out + i, count - i);
+#endif
+    for (; i < count; i++)
+    {
+        out[i] = noise3f(x[i], y[i], z[i]);
+    }
+}
+
+void Perlin::perlin3(const float *x, const float *y, const float *z, float *out, int count)
+{
+    const int BATCH = 64;
+    float sx[BATCH], sy[BATCH], sz[BATCH], n[BATCH];
+
+    for (int start = 0; start < count; start += BATCH)
+    {
+        int size = count - start < BATCH ? count - start : BATCH;
+        float frequency = static_cast<float>(m_frequency);
+        float amplitude = static_cast<float>(m_amplitude);
+
+        for (int i = 0; i < size; i++)
+            out[start + i] = 0.0f;
+
+        for (int octave = 0; octave < m_octaves; octave++)
+        {
+            for (int i = 0; i < size; i++)
+            {
+                sx[i] = x[start + i] * frequency;
+                sy[i] = y[start + i] * frequency;
+                sz[i] = z[start + i] * frequency;
+            }
+
+            noise3(sx, sy, sz, n, size);
+
+            for (int i = 0; i < size; i++)
+                out[start + i] += n[i] * amplitude;
+
+            amplitude *= static_cast<float>(m_persistence);
+            frequency *= static_cast<float>(m_lacunarity);
+        }
+    }
 }
\ No newline at end of file
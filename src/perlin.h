@@ -1,19 +1,31 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
-#include <vector>
 
 class Perlin
 {
 public:
     Perlin();
-    Perlin(int octaves, double frequency, double amplitude, double lacunarity, double persistence);
+    Perlin(int octaves, double frequency, double amplitude, double lacunarity, double persistence,
+        std::uint64_t seed = 0);
 
     double perlin3(double x, double y, double z);
     double noise3(double x, double y, double z);
 
+    float noise3f(float x, float y, float z);
+    void perlin3(const float *x, const float *y, const float *z, float *out, int count);
+    void noise3(const float *x, const float *y, const float *z, float *out, int count);
+
+    double range() const;
+    double curvature() const;
+
 private:
-    std::vector<std::uint8_t> m_p;
+    void permute(std::uint64_t seed);
+
+    // 32 bit entries so the AVX2 path can gather straight from the table, the copy in the upper half
+    // saves wrapping the second lookup of each axis
+    alignas(64) std::array<std::int32_t, 512> m_p;
 
     int m_octaves;
     double m_frequency;
@@ -0,0 +1,76 @@
+// the vector noise kernel, perlin.cpp includes it inside one namespace per instruction set after defining
+// vfloat, vint, LANES and the operations below for it, so there is deliberately no include guard
+
+static inline vfloat vfade(vfloat t)
+{
+    vfloat t3 = vmul(vmul(t, t), t);
+    return vmul(t3, vadd(vmul(t, vsub(vmul(t, vset(6.0f)), vset(15.0f))), vset(10.0f)));
+}
+
+static inline vfloat vlerp(vfloat t, vfloat a, vfloat b)
+{
+    return vadd(a, vmul(t, vsub(b, a)));
+}
+
+static inline vfloat vgrad(vint hash, vfloat x, vfloat y, vfloat z)
+{
+    vint h = iand(hash, iset(0xF));
+    vfloat u = vselect(ilt(h, iset(8)), x, y);
+    vint hx = ior(ieq(h, iset(12)), ieq(h, iset(14)));
+    vfloat v = vselect(ilt(h, iset(4)), y, vselect(hx, x, z));
+    u = vxor(u, vsign(iand(h, iset(1)), 31));
+    v = vxor(v, vsign(iand(h, iset(2)), 30));
+    return vadd(u, v);
+}
+
+static inline vfloat vnoise3(const std::int32_t *p, vfloat x, vfloat y, vfloat z)
+{
+    vfloat fx = vfloor(x);
+    vfloat fy = vfloor(y);
+    vfloat fz = vfloor(z);
+
+    vint mask = iset(255);
+    vint X = iand(vtoint(fx), mask);
+    vint Y = iand(vtoint(fy), mask);
+    vint Z = iand(vtoint(fz), mask);
+
+    x = vsub(x, fx);
+    y = vsub(y, fy);
+    z = vsub(z, fz);
+
+    vfloat u = vfade(x);
+    vfloat v = vfade(y);
+    vfloat w = vfade(z);
+
+    vint one = iset(1);
+    vint A = iadd(gather(p, X), Y);
+    vint AA = iadd(gather(p, A), Z);
+    vint AB = iadd(gather(p, iadd(A, one)), Z);
+    vint B = iadd(gather(p, iadd(X, one)), Y);
+    vint BA = iadd(gather(p, B), Z);
+    vint BB = iadd(gather(p, iadd(B, one)), Z);
+
+    vfloat x1 = vsub(x, vset(1.0f));
+    vfloat y1 = vsub(y, vset(1.0f));
+    vfloat z1 = vsub(z, vset(1.0f));
+
+    return vlerp(w, vlerp(v, vlerp(u, vgrad(gather(p, AA), x, y, z),
+                                      vgrad(gather(p, BA), x1, y, z)),
+                             vlerp(u, vgrad(gather(p, AB), x, y1, z),
+                                      vgrad(gather(p, BB), x1, y1, z))),
+                    vlerp(v, vlerp(u, vgrad(gather(p, iadd(AA, one)), x, y, z1),
+                                      vgrad(gather(p, iadd(BA, one)), x1, y, z1)),
+                             vlerp(u, vgrad(gather(p, iadd(AB, one)), x, y1, z1),
+                                      vgrad(gather(p, iadd(BB, one)), x1, y1, z1))));
+}
+
+// whole vectors only, returns how many values it wrote
+static int noise3(const std::int32_t *p, const float *x, const float *y, const float *z, float *out, int count)
+{
+    int i = 0;
+    for (; i + LANES <= count; i += LANES)
+    {
+        vstore(out + i, vnoise3(p, vload(x + i), vload(y + i), vload(z + i)));
+    }
+    return i;
+}
\ No newline at end of file
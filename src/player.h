@@ -17,6 +17,7 @@ public:
 
     const glm::vec3 &getPos() const { return m_pos; };
     void setPos(const glm::vec3 &pos) { m_pos = pos; };
+    const glm::vec3 &getVelocity() const { return m_moveVel; };
 
     float getFov() const { return m_fov; };
 
@@ -0,0 +1,81 @@
+#include "poolbenchmark.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+#include "lockedthreadpool.h"
+#include "random.h"
+#include "threadpool.h"
+
+namespace PoolBenchmark
+{
+    static const int JOBS = 200000;
+    static const int SPAWNERS = 64;
+    static const int WORK = 64;
+
+    static std::atomic<uint64_t> sink(0);
+
+    // roughly a microsecond of arithmetic, short enough for queue overhead to dominate
+    static void work(uint64_t seed)
+    {
+        uint64_t h = seed;
+        for (int i = 0; i < WORK; i++)
+            h = Random::mix(h + i);
+        sink.fetch_xor(h, std::memory_order_relaxed);
+    }
+
+    // every job is added from the calling thread
+    template<typename Pool>
+    static double flat(Pool &pool)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < JOBS; i++)
+            pool.addJob([i] { work(i); });
+        pool.waitUntilCompleted();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // a few jobs add the rest from inside the pool
+    template<typename Pool>
+    static double nested(Pool &pool)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < SPAWNERS; i++)
+        {
+            pool.addJob([&pool, i]
+            {
+                for (int j = 0; j < JOBS / SPAWNERS; j++)
+                    pool.addJob([i, j] { work(i * JOBS + j); });
+            });
+        }
+        pool.waitUntilCompleted();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    template<typename Pool>
+    static void measure(const char *name, int threads)
+    {
+        Pool pool(threads);
+        double a = flat(pool);
+        double b = nested(pool);
+
+        std::cout << std::setw(8) << name << std::setw(8) << threads
+            << std::setw(14) << static_cast<int>(JOBS / a)
+            << std::setw(14) << static_cast<int>(JOBS / b) << std::endl;
+    }
+
+    void run()
+    {
+        std::cout << std::setw(8) << "pool" << std::setw(8) << "threads"
+            << std::setw(14) << "flat jobs/s" << std::setw(14) << "nested jobs/s" << std::endl;
+
+        for (int threads = 1; threads <= 64; threads *= 2)
+        {
+            measure<LockedThreadPool>("locked", threads);
+            measure<ThreadPool>("stealing", threads);
+        }
+    }
+}
\ No newline at end of file
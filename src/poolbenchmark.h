@@ -0,0 +1,7 @@
+#pragma once
+
+// times the work stealing pool against the locked single queue pool on short jobs, at 1 to 64 threads
+namespace PoolBenchmark
+{
+    void run();
+}
\ No newline at end of file
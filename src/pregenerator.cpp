@@ -0,0 +1,248 @@
+#include "pregenerator.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include "blocks.h"
+#include "computejob.h"
+#include "lighting.h"
+
+Pregenerator::Pregenerator(uint64_t seed, const std::string &outDir, const ThreadLanes::Settings &lanes) :
+    m_generator(seed), m_lanes(lanes), m_outDir(outDir)
+{
+}
+
+void Pregenerator::run(int x0, int z0, int x1, int z1)
+{
+    if (x1 < x0)
+        std::swap(x0, x1);
+    if (z1 < z0)
+        std::swap(z0, z1);
+
+    std::error_code error;
+    std::filesystem::create_directories(m_outDir, error);
+    if (error)
+    {
+        std::cout << "error: can't create " << m_outDir << ": " << error.message() << std::endl;
+        return;
+    }
+
+    std::cout << "pregenerating " << (x1 - x0 + 1) * (z1 - z0 + 1) << " columns on " << m_lanes.get(ThreadLanes::Generate).getWorkerAmount()
+        << " threads" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    auto phase = start;
+    auto lap = [&phase]() -> double
+    {
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - phase).count();
+        phase = now;
+        return seconds;
+    };
+
+    generate(x0, z0, x1, z1);
+    report("generate", m_chunks.size(), lap());
+
+    int rounds = light();
+    report("light (" + std::to_string(rounds) + " rounds)", m_chunks.size(), lap());
+
+    mesh();
+    report("mesh", m_chunks.size(), lap());
+
+    if (!write())
+        return;
+    report("write", m_chunks.size(), lap());
+
+    report("total", m_chunks.size(), std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+void Pregenerator::generate(int x0, int z0, int x1, int z1)
+{
+    std::vector<std::vector<std::unique_ptr<Chunk>>> columns;
+    std::vector<std::unique_ptr<Chunk>> placeholders;
+
+    for (int x = x0; x <= x1; x++)
+    {
+        for (int z = z0; z <= z1; z++)
+        {
+            std::vector<std::unique_ptr<Chunk>> column;
+            for (int y = HEIGHT - 1; y >= 0; y--)
+            {
+                glm::ivec3 coords(x, y, z);
+                TerrainGenerator::Classification type = m_generator.classify(coords);
+                if (type == TerrainGenerator::Sky)
+                    placeholders.push_back(std::make_unique<Chunk>(coords, Blocks::Air, 0xF0));
+                else if (type == TerrainGenerator::Buried)
+                    placeholders.push_back(std::make_unique<Chunk>(coords, Blocks::Stone, 0));
+                else
+                    column.push_back(std::make_unique<Chunk>(coords));
+            }
+
+            if (!column.empty())
+                columns.push_back(std::move(column));
+        }
+    }
+
+    std::vector<Job> batch;
+    for (auto &column : columns)
+    {
+        std::vector<Chunk*> chunks;
+        for (auto &c : column)
+            chunks.push_back(c.get());
+
+        batch.push_back([chunks, this]() mutable -> void
+        {
+            m_generator.generateColumn(chunks);
+        });
+    }
+    ThreadPool &pool = m_lanes.get(ThreadLanes::Generate);
+    pool.addJobs(batch);
+    pool.waitUntilCompleted();
+
+    auto insert = [this](std::unique_ptr<Chunk> c) -> void
+    {
+        Chunk &chunk = *c;
+        m_chunks.insert(std::make_pair(chunk.getCoords(), std::move(c)));
+        Lighting::onLoaded(chunk, m_chunks);
+    };
+
+    for (auto &column : columns)
+    {
+        for (auto &c : column)
+            insert(std::move(c));
+    }
+
+    for (auto &c : placeholders)
+        insert(std::move(c));
+
+    placeLateStructures();
+}
+
+// everything is loaded by now, so a late write with no target fell outside the region
+void Pregenerator::placeLateStructures()
+{
+    for (const auto &w : m_generator.takeLateStructures())
+    {
+        auto it = m_chunks.find(w.target);
+        if (it == m_chunks.end())
+            continue;
+
+        Chunk &c = *it->second;
+        if (!StructureBuffer::canReplace(c.getBlock(w.x, w.y, w.z), w.type))
+            continue;
+
+        c.editBlock(w.x, w.y, w.z, w.type);
+    }
+}
+
+int Pregenerator::light()
+{
+    // a job reads a one block shell of its neighbors while updating its own chunk, so chunks only run
+    // alongside others of the same parity on every axis, those never touch
+    int rounds = 0;
+    bool pending = true;
+    while (pending)
+    {
+        pending = false;
+        for (int parity = 0; parity < 8; parity++)
+        {
+            std::vector<std::unique_ptr<ComputeJob>> jobs;
+            for (auto &it : m_chunks)
+            {
+                Chunk &c = *it.second;
+                const glm::ivec3 &coords = c.getCoords();
+                if (!c.isLightDirty() || ((coords.x & 1) | (coords.y & 1) << 1 | (coords.z & 1) << 2) != parity)
+                    continue;
+
+                c.setLightDirty(false);
+                jobs.push_back(std::make_unique<ComputeJob>(c, m_chunks, c.getVersion(), true));
+            }
+
+            if (jobs.empty())
+                continue;
+
+            execute(jobs);
+            pending = true;
+        }
+
+        if (pending)
+            rounds++;
+    }
+
+    return rounds;
+}
+
+void Pregenerator::mesh()
+{
+    // light has settled, so these only read their neighbors
+    std::vector<std::unique_ptr<ComputeJob>> jobs;
+    for (auto &it : m_chunks)
+    {
+        Chunk &c = *it.second;
+        if (!c.isMaterialized())
+            continue;
+
+        c.setDirty(false);
+        jobs.push_back(std::make_unique<ComputeJob>(c, m_chunks, c.getVersion()));
+    }
+
+    execute(jobs);
+}
+
+void Pregenerator::execute(std::vector<std::unique_ptr<ComputeJob>> &jobs)
+{
+    std::vector<Job> batch;
+    for (auto &job : jobs)
+    {
+        ComputeJob *j = job.get();
+        batch.push_back([j]() -> void { j->execute(); });
+    }
+    ThreadPool &pool = m_lanes.get(ThreadLanes::Stream);
+    pool.addJobs(batch);
+    pool.waitUntilCompleted();
+
+    for (auto &job : jobs)
+        job->transfer();
+}
+
+bool Pregenerator::write()
+{
+    std::atomic<int> failed(0);
+    std::vector<Job> batch;
+    for (auto &it : m_chunks)
+    {
+        Chunk *c = it.second.get();
+        batch.push_back([c, &failed, this]() -> void
+        {
+            const glm::ivec3 &coords = c->getCoords();
+            std::string name = std::to_string(coords.x) + "_" + std::to_string(coords.y) + "_" +
+                std::to_string(coords.z) + ".chunk";
+
+            std::ofstream file(std::filesystem::path(m_outDir) / name, std::ios::binary);
+            c->write(file);
+            if (!file)
+                failed++;
+        });
+    }
+    ThreadPool &pool = m_lanes.get(ThreadLanes::Save);
+    pool.addJobs(batch);
+    pool.waitUntilCompleted();
+
+    if (failed > 0)
+    {
+        std::cout << "error: failed to write " << failed << " chunks to " << m_outDir << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void Pregenerator::report(const std::string &phase, size_t count, double seconds)
+{
+    std::cout << phase << ": " << count << " chunks in " << seconds * 1000.0 << "ms, " <<
+        static_cast<int>(count / seconds) << " chunks/s" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "chunk.h"
+#include "computejob.h"
+#include "terraingenerator.h"
+#include "threadlanes.h"
+
+// generates, lights and meshes a rectangle of columns without a window and writes every chunk to disk
+class Pregenerator
+{
+public:
+    Pregenerator(uint64_t seed, const std::string &outDir, const ThreadLanes::Settings &lanes);
+
+    void run(int x0, int z0, int x1, int z1);
+
+private:
+    static const int HEIGHT = 17;
+
+    void generate(int x0, int z0, int x1, int z1);
+    void placeLateStructures();
+    int light();
+    void mesh();
+    void execute(std::vector<std::unique_ptr<ComputeJob>> &jobs);
+    bool write();
+    void report(const std::string &phase, size_t count, double seconds);
+
+    TerrainGenerator m_generator;
+    ChunkMap m_chunks;
+    ThreadLanes m_lanes;
+    std::string m_outDir;
+};
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+// Stateless counter based random numbers, the same seed and coordinates always give the same values
+namespace Random
+{
+    // SplitMix64 finalizer
+    inline uint64_t mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    inline uint64_t hash(uint64_t seed, int x, int y, int z)
+    {
+        uint64_t h = mix(seed + static_cast<uint32_t>(x));
+        h = mix(h + static_cast<uint32_t>(y));
+        return mix(h + static_cast<uint32_t>(z));
+    }
+
+    // 24 high bits mapped to [0, 1)
+    inline float toFloat(uint64_t bits)
+    {
+        return static_cast<float>(bits >> 40) * (1.0f / 16777216.0f);
+    }
+
+    class Stream
+    {
+    public:
+        Stream(uint64_t seed, int x, int y, int z) : m_counter(hash(seed, x, y, z)) {};
+
+        uint64_t next()
+        {
+            m_counter += 0x9E3779B97F4A7C15ull;
+            return mix(m_counter);
+        }
+
+        float nextFloat() { return toFloat(next()); };
+
+    private:
+        uint64_t m_counter;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "structurebuffer.h"
+
+#include <algorithm>
+
+#include "blocks.h"
+
+// leaves fill in around terrain and other trees instead of replacing them
+bool StructureBuffer::canReplace(int current, int type)
+{
+    return type != Blocks::Leaves || !Blocks::isSolid(current);
+}
+
+StructureBuffer::Shard &StructureBuffer::shard(const glm::ivec3 &coords)
+{
+    uint32_t h = static_cast<uint32_t>(coords.x) * 73856093u ^ static_cast<uint32_t>(coords.y) * 19349663u ^
+        static_cast<uint32_t>(coords.z) * 83492791u;
+    return m_shards[h % SHARDS];
+}
+
+// writes stay in the buffer while their source is loaded, so a target that unloads and
+// generates again gets them back
+void StructureBuffer::post(const glm::ivec3 &target, std::vector<Write> &writes)
+{
+    bool late;
+    {
+        Shard &s = shard(target);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        Pending &pending = s.chunks[target];
+        pending.writes.insert(pending.writes.end(), writes.begin(), writes.end());
+        late = pending.generated;
+    }
+
+    if (late)
+    {
+        std::lock_guard<std::mutex> lock(m_lateMutex);
+        m_late.insert(m_late.end(), writes.begin(), writes.end());
+    }
+}
+
+std::vector<StructureBuffer::Write> StructureBuffer::take(const glm::ivec3 &coords)
+{
+    Shard &s = shard(coords);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    Pending &pending = s.chunks[coords];
+    pending.generated = true;
+    return pending.writes;
+}
+
+std::vector<StructureBuffer::Write> StructureBuffer::takeLate()
+{
+    std::lock_guard<std::mutex> lock(m_lateMutex);
+    std::vector<Write> late;
+    std::swap(late, m_late);
+    return late;
+}
+
+// called when a chunk unloads, it is no longer generated and its own writes into neighbors are dropped
+void StructureBuffer::release(const glm::ivec3 &coords)
+{
+    for (int x = -1; x < 2; x++)
+    {
+        for (int y = -1; y < 2; y++)
+        {
+            for (int z = -1; z < 2; z++)
+            {
+                glm::ivec3 target = coords + glm::ivec3(x, y, z);
+                Shard &s = shard(target);
+                std::lock_guard<std::mutex> lock(s.mutex);
+                auto it = s.chunks.find(target);
+                if (it == s.chunks.end())
+                    continue;
+
+                Pending &pending = it->second;
+                if (target == coords)
+                    pending.generated = false;
+
+                pending.writes.erase(std::remove_if(pending.writes.begin(), pending.writes.end(),
+                    [&coords](const Write &w) { return w.source == coords; }), pending.writes.end());
+
+                if (pending.writes.empty() && !pending.generated)
+                    s.chunks.erase(it);
+            }
+        }
+    }
+}
\ No newline at end of file
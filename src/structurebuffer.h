@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "chunkcompare.h"
+
+// Blocks that structures like trees place outside the chunk being generated. Writes wait here until
+// their target generates, or come back through takeLate() when the target already has.
+class StructureBuffer
+{
+public:
+    struct Write
+    {
+        glm::ivec3 source;
+        glm::ivec3 target;
+        uint8_t x, y, z;
+        uint8_t type;
+    };
+
+    static bool canReplace(int current, int type);
+
+    void post(const glm::ivec3 &target, std::vector<Write> &writes);
+    std::vector<Write> take(const glm::ivec3 &coords);
+    std::vector<Write> takeLate();
+    void release(const glm::ivec3 &coords);
+
+private:
+    static const int SHARDS = 16;
+
+    struct Pending
+    {
+        Pending() : generated(false) {};
+
+        std::vector<Write> writes;
+        bool generated;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::map<glm::ivec3, Pending, ChunkCompare> chunks;
+    };
+
+    Shard &shard(const glm::ivec3 &coords);
+
+    Shard m_shards[SHARDS];
+    std::mutex m_lateMutex;
+    std::vector<Write> m_late;
+};
\ No newline at end of file
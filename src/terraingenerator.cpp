@@ -1,90 +1,204 @@
 #include "terraingenerator.h"
 
 #include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
 
 #include <glm/glm.hpp>
 
 #include "blocks.h"
+#include "random.h"
+#include "terraingraph.h"
 
-TerrainGenerator::TerrainGenerator() :
-    m_highNoise(2, 0.023, 14, 2, 0.5), m_lowNoise(2, 0.017, 5, 2, 0.9),
-    m_trees(2, 1.71, 1, 2, 0.7), m_flowers(2, 0.1, 1, 2, 0.7),
-    m_grass(2, 0.1, 1, 2, 0.8)
+// caves stay below the grass and dirt so they never cut into decoration
+static const int CAVE_MARGIN = 4;
+// the biome's filler block sits under its top block
+static const int FILLER_DEPTH = 4;
+
+// a tree fills the 7 blocks from the surface up
+static const int TREE_HEIGHT = 7;
+
+TerrainGenerator::TerrainGenerator(uint64_t seed) : m_graph(seed), m_biomes(seed), m_columns(1024), m_seed(seed)
 {
-    
+    // res/terrain.graph is compiled in, so the terrain for a seed doesn't depend on where the game runs from
+    if (m_graph.parse(terrainGraph))
+        m_height = m_graph.compile("height");
+
+    if (!m_height.valid())
+    {
+        std::cout << "error: res/terrain.graph has no usable height node" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    m_carve = m_graph.compile("carve");
 }
 
-static bool canPutTree(int x, int y, int z);
+// decides from surface and cave bounds alone whether a chunk is all air or all stone with stone around it
+TerrainGenerator::Classification TerrainGenerator::classify(const glm::ivec3 &coords)
+{
+    if (coords.y < 0)
+        return Sky;
+
+    // neighboring columns count too, trees hang over and their stone hides our faces
+    int minHeight = std::numeric_limits<int>::max();
+    int maxHeight = std::numeric_limits<int>::min();
+    bool cached = true;
+    for (int x = -1; x < 2 && cached; x++)
+    {
+        for (int z = -1; z < 2 && cached; z++)
+        {
+            auto column = m_columns.peek(coords.x + x, coords.z + z);
+            if (!column)
+            {
+                cached = false;
+                break;
+            }
+            minHeight = (std::min)(minHeight, column->minHeight);
+            maxHeight = (std::max)(maxHeight, column->maxHeight);
+        }
+    }
+
+    if (!cached)
+    {
+        glm::vec3 min(coords.x * 16 - 16, 0, coords.z * 16 - 16);
+        NoiseGraph::Interval bounds = m_graph.bounds(m_height, min, min + glm::vec3(47, 0, 47));
+        m_biomes.heightRange(bounds.min, bounds.max);
+        minHeight = static_cast<int>(std::floor(bounds.min));
+        maxHeight = static_cast<int>(std::floor(bounds.max));
+    }
+
+    int bottom = coords.y * 16;
+    if (bottom >= maxHeight + TREE_HEIGHT)
+        return Sky;
+
+    // stone stops below the filler, bedrock is at 0
+    if (bottom < 1 || bottom + CHUNK_SIZE >= minHeight - FILLER_DEPTH)
+        return Generate;
+
+    if (m_carve.valid())
+    {
+        glm::vec3 min = static_cast<glm::vec3>(coords * 16) - glm::vec3(1);
+        if (m_graph.bounds(m_carve, min, min + glm::vec3(CHUNK_SIZE + 1)).max > 0.0f)
+            return Generate;
+    }
+
+    return Buried;
+}
 
 void TerrainGenerator::generate(Chunk &c)
 {
     const glm::ivec3 &coords = c.getCoords();
 
-    if (coords.y < 0 || coords.y > 16) 
+    // every chunk stacked on this x,z shares the same heightmap and decoration noise
+    auto column = m_columns.get(coords.x, coords.z, [this, &coords](ColumnData &data)
+    {
+        fillColumn(coords.x, coords.z, data);
+    });
+
+    fillSection(c, *column);
+}
+
+void TerrainGenerator::generateColumn(std::vector<Chunk*> &chunks)
+{
+    if (chunks.empty())
+        return;
+
+    std::sort(chunks.begin(), chunks.end(), [](Chunk *a, Chunk *b)
+    {
+        return a->getCoords().y > b->getCoords().y;
+    });
+
+    glm::ivec3 coords = chunks.front()->getCoords();
+    auto column = m_columns.get(coords.x, coords.z, [this, &coords](ColumnData &data)
+    {
+        fillColumn(coords.x, coords.z, data);
+    });
+
+    for (Chunk *c : chunks)
+    {
+        fillSection(*c, *column);
+    }
+}
+
+void TerrainGenerator::fillSection(Chunk &c, const ColumnData &column)
+{
+    const glm::ivec3 &coords = c.getCoords();
+
+    if (coords.y < 0)
         return;
 
+    // above the highest column there is only air, apart from trees growing in from below
+    if (coords.y > 16 || coords.y * 16 > column.maxHeight)
+    {
+        c.setSky(true);
+        applyStructures(c);
+        return;
+    }
+
+    std::vector<float> carve;
+    bool carveAll = carveSection(coords, column, carve);
+
     for (int x = 0; x < CHUNK_SIZE; x++)
     {
         for (int z = 0; z < CHUNK_SIZE; z++)
         {
-            int rx = coords.x * 16 + x;
+            int i = x * CHUNK_SIZE + z;
             int ry = coords.y * 16;
-            int rz = coords.z * 16 + z;
 
-            int h = static_cast<int>(std::floor(getHeight(rx, rz)));
+            int h = column.heights[i];
             int dh = h - ry;
             if (dh < 0)
                 continue;
 
             dh = (std::min)(16, dh);
-            for (int y = 0; y < dh; y++)
+            for (int y = 0; y < dh; y++, ry++)
             {
+                bool cave = carveAll || (!carve.empty() && carve[(x * CHUNK_SIZE + y) * CHUNK_SIZE + z] > 0.0f);
+                if (cave && ry > 0 && ry < h - CAVE_MARGIN)
+                    continue;
+
                 if (ry == 0)
                 {
                     c.setBlock(x, y, z, Blocks::Bedrock);
                 }
                 else if (ry == h - 1)
                 {
-                    c.setBlock(x, y, z, Blocks::Grass);
+                    c.setBlock(x, y, z, column.top[i]);
                 }
-                else
+                else if (ry >= h - FILLER_DEPTH)
                 {
-                    if (ry < h && ry > h - 2)
-                    {
-                        c.setBlock(x, y, z, Blocks::Dirt);
-                    }
-                    else
-                    {
-                        c.setBlock(x, y, z, Blocks::Stone);
-                    }
-                }
-                ry++;
-            }
-
-            if (canPutTree(x, dh, z) && m_trees.perlin3(rx, ry, rz) > 0.8)
-            {
-                putTree(c, x, dh, z);
-            }
-            else if (dh < 15)
-            {
-                if (m_grass.perlin3(-rx, ry, -rz) > 0.4)
-                {
-                    c.setBlock(x, dh, z, Blocks::GrassPlant);
+                    c.setBlock(x, y, z, column.filler[i]);
                 }
                 else
                 {
-                    double flower = m_flowers.perlin3(rx, ry, rz);
-                    if (flower > 0.65)
-                    {
-                        double type = m_flowers.noise3(rx + 0.27, -ry, rz + 0.31);
-                        c.setBlock(x, dh, z, type > 0 ? Blocks::YellowFlower : Blocks::RedFlower);
-                    }
+                    c.setBlock(x, y, z, Blocks::Stone);
                 }
-            } 
+            }
+        }
+    }
+
+    // trees may hang over into neighboring chunks, those blocks go through the structure buffer
+    std::vector<StructureBuffer::Write> overflow;
+    for (int x = 0; x < CHUNK_SIZE; x++)
+    {
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        {
+            int i = x * CHUNK_SIZE + z;
+            int top = column.heights[i] - coords.y * 16;
+            if (top < 0 || top >= CHUNK_SIZE)
+                continue;
+
+            if (column.trees[i])
+                putTree(c, x, top, z, overflow);
+            else if (column.plants[i] != Blocks::Air)
+                c.setBlock(x, top, z, column.plants[i]);
         }
     }
 
+    postOverflow(overflow);
+    applyStructures(c);
+
     if (coords == glm::ivec3(-6, 3, -2))
     {
         c.setBlock(8, 1, 4, Blocks::Glowstone);
@@ -99,69 +213,176 @@ void TerrainGenerator::generate(Chunk &c)
     }
 }
 
-static bool canPutTree(int x, int y, int z)
+// fills carve with the density of the section, or leaves it empty when the graph's bounds already
+// decide every block. Returns true when the whole section is carved.
+bool TerrainGenerator::carveSection(const glm::ivec3 &coords, const ColumnData &column, std::vector<float> &carve)
+{
+    int bottom = coords.y * 16;
+    if (!m_carve.valid() || bottom >= column.maxHeight - CAVE_MARGIN)
+        return false;
+
+    glm::vec3 min = static_cast<glm::vec3>(coords * 16);
+    NoiseGraph::Interval bounds = m_graph.bounds(m_carve, min, min + glm::vec3(CHUNK_SIZE - 1));
+    if (bounds.max <= 0.0f)
+        return false;
+    if (bounds.min > 0.0f)
+        return true;
+
+    carve.resize(CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE);
+    m_graph.evaluate3D(m_carve, coords.x * 16, coords.y * 16, coords.z * 16, carve.data());
+    return false;
+}
+
+// sets the block if it is inside c, otherwise queues it for the neighbor it falls into
+static void place(Chunk &c, std::vector<StructureBuffer::Write> &overflow, int x, int y, int z, uint8_t type)
+{
+    glm::ivec3 local(x, y, z);
+    glm::ivec3 offset = glm::ivec3(glm::floor(static_cast<glm::vec3>(local) / static_cast<float>(CHUNK_SIZE)));
+    if (offset == glm::ivec3(0))
+    {
+        if (StructureBuffer::canReplace(c.getBlock(x, y, z), type))
+            c.setBlock(x, y, z, type);
+        return;
+    }
+
+    local -= offset * CHUNK_SIZE;
+    overflow.push_back({ c.getCoords(), c.getCoords() + offset, static_cast<uint8_t>(local.x),
+        static_cast<uint8_t>(local.y), static_cast<uint8_t>(local.z), type });
+}
+
+void TerrainGenerator::postOverflow(std::vector<StructureBuffer::Write> &overflow)
+{
+    std::sort(overflow.begin(), overflow.end(), [](const StructureBuffer::Write &a, const StructureBuffer::Write &b)
+    {
+        return ChunkCompare()(a.target, b.target);
+    });
+
+    size_t start = 0;
+    while (start < overflow.size())
+    {
+        size_t end = start;
+        while (end < overflow.size() && overflow[end].target == overflow[start].target)
+            end++;
+
+        std::vector<StructureBuffer::Write> writes(overflow.begin() + start, overflow.begin() + end);
+        m_structures.post(overflow[start].target, writes);
+        start = end;
+    }
+}
+
+void TerrainGenerator::applyStructures(Chunk &c)
+{
+    for (const auto &w : m_structures.take(c.getCoords()))
+    {
+        if (StructureBuffer::canReplace(c.getBlock(w.x, w.y, w.z), w.type))
+            c.setBlock(w.x, w.y, w.z, w.type);
+    }
+}
+
+std::vector<StructureBuffer::Write> TerrainGenerator::takeLateStructures()
 {
-    return y < 9 && x > 2 && x < 13 && z > 2 && z < 13;
+    return m_structures.takeLate();
 }
 
-void TerrainGenerator::putTree(Chunk &c, int x, int y, int z)
+void TerrainGenerator::release(const glm::ivec3 &coords)
+{
+    m_structures.release(coords);
+}
+
+void TerrainGenerator::putTree(Chunk &c, int x, int y, int z, std::vector<StructureBuffer::Write> &overflow)
 {
     for (int i = y + 3; i < y + 5; i++)
     {
-        c.setBlock(x - 1, i, z - 2, Blocks::Leaves);
-        c.setBlock(x + 0, i, z - 2, Blocks::Leaves);
-        c.setBlock(x + 1, i, z - 2, Blocks::Leaves);
-        if (i == y + 4) c.setBlock(x + 2, i, z - 2, Blocks::Leaves);
+        place(c, overflow, x - 1, i, z - 2, Blocks::Leaves);
+        place(c, overflow, x + 0, i, z - 2, Blocks::Leaves);
+        place(c, overflow, x + 1, i, z - 2, Blocks::Leaves);
+        if (i == y + 4) place(c, overflow, x + 2, i, z - 2, Blocks::Leaves);
 
-        c.setBlock(x - 2, i, z - 1, Blocks::Leaves);
-        c.setBlock(x - 1, i, z - 1, Blocks::Leaves);
-        c.setBlock(x + 0, i, z - 1, Blocks::Leaves);
-        c.setBlock(x + 1, i, z - 1, Blocks::Leaves);
-        c.setBlock(x + 2, i, z - 1, Blocks::Leaves);
+        place(c, overflow, x - 2, i, z - 1, Blocks::Leaves);
+        place(c, overflow, x - 1, i, z - 1, Blocks::Leaves);
+        place(c, overflow, x + 0, i, z - 1, Blocks::Leaves);
+        place(c, overflow, x + 1, i, z - 1, Blocks::Leaves);
+        place(c, overflow, x + 2, i, z - 1, Blocks::Leaves);
 
-        c.setBlock(x - 2, i, z + 0, Blocks::Leaves);
-        c.setBlock(x - 1, i, z + 0, Blocks::Leaves);
-        c.setBlock(x + 0, i, z + 0, Blocks::Leaves);
-        c.setBlock(x + 1, i, z + 0, Blocks::Leaves);
-        c.setBlock(x + 2, i, z + 0, Blocks::Leaves);
+        place(c, overflow, x - 2, i, z + 0, Blocks::Leaves);
+        place(c, overflow, x - 1, i, z + 0, Blocks::Leaves);
+        place(c, overflow, x + 0, i, z + 0, Blocks::Leaves);
+        place(c, overflow, x + 1, i, z + 0, Blocks::Leaves);
+        place(c, overflow, x + 2, i, z + 0, Blocks::Leaves);
 
-        c.setBlock(x - 2, i, z + 1, Blocks::Leaves);
-        c.setBlock(x - 1, i, z + 1, Blocks::Leaves);
-        c.setBlock(x + 0, i, z + 1, Blocks::Leaves);
-        c.setBlock(x + 1, i, z + 1, Blocks::Leaves);
-        c.setBlock(x + 2, i, z + 1, Blocks::Leaves);
+        place(c, overflow, x - 2, i, z + 1, Blocks::Leaves);
+        place(c, overflow, x - 1, i, z + 1, Blocks::Leaves);
+        place(c, overflow, x + 0, i, z + 1, Blocks::Leaves);
+        place(c, overflow, x + 1, i, z + 1, Blocks::Leaves);
+        place(c, overflow, x + 2, i, z + 1, Blocks::Leaves);
 
-        c.setBlock(x - 1, i, z + 2, Blocks::Leaves);
-        c.setBlock(x + 0, i, z + 2, Blocks::Leaves);
-        c.setBlock(x + 1, i, z + 2, Blocks::Leaves);
-        if (i == y + 4) c.setBlock(x + 2, i, z + 2, Blocks::Leaves);
+        place(c, overflow, x - 1, i, z + 2, Blocks::Leaves);
+        place(c, overflow, x + 0, i, z + 2, Blocks::Leaves);
+        place(c, overflow, x + 1, i, z + 2, Blocks::Leaves);
+        if (i == y + 4) place(c, overflow, x + 2, i, z + 2, Blocks::Leaves);
     }
 
-    c.setBlock(x - 1, y + 5, z + 1, Blocks::Leaves);
+    place(c, overflow, x - 1, y + 5, z + 1, Blocks::Leaves);
 
     for (int i = y + 5; i < y + 7; i++)
     {
-        c.setBlock(x - 1, i, z + 0, Blocks::Leaves);
-        c.setBlock(x + 0, i, z - 1, Blocks::Leaves);
-        c.setBlock(x + 1, i, z + 0, Blocks::Leaves);
-        c.setBlock(x + 0, i, z + 1, Blocks::Leaves);
+        place(c, overflow, x - 1, i, z + 0, Blocks::Leaves);
+        place(c, overflow, x + 0, i, z - 1, Blocks::Leaves);
+        place(c, overflow, x + 1, i, z + 0, Blocks::Leaves);
+        place(c, overflow, x + 0, i, z + 1, Blocks::Leaves);
     }
 
-    c.setBlock(x, y + 6, z, Blocks::Leaves);
+    place(c, overflow, x, y + 6, z, Blocks::Leaves);
 
     for (int ty = 0; ty < 6; ty++)
     {
-        c.setBlock(x, y + ty, z, Blocks::Log);
+        place(c, overflow, x, y + ty, z, Blocks::Log);
     }
     //c.setBlock(x, y, z, Blocks::Glowstone);
 }
 
-double TerrainGenerator::getHeight(double x, double z)
+void TerrainGenerator::fillColumn(int cx, int cz, ColumnData &column)
+{
+    const int COLUMNS = ColumnData::COLUMNS;
+    float heights[COLUMNS];
+    BiomeMap::Column biomes[COLUMNS];
+    getHeights(cx, cz, heights);
+    m_biomes.sample(cx, cz, biomes);
+
+    column.minHeight = std::numeric_limits<int>::max();
+    column.maxHeight = std::numeric_limits<int>::min();
+
+    for (int x = 0; x < CHUNK_SIZE; x++)
+    {
+        for (int z = 0; z < CHUNK_SIZE; z++)
+        {
+            int i = x * CHUNK_SIZE + z;
+            const BiomeMap::Params &params = biomes[i].params;
+
+            float height = BiomeMap::BASE_HEIGHT + (heights[i] - BiomeMap::BASE_HEIGHT) * params.heightScale +
+                params.heightOffset;
+            int h = glm::clamp(static_cast<int>(std::floor(height)), 1, 255);
+            column.heights[i] = h;
+            column.minHeight = (std::min)(column.minHeight, h);
+            column.maxHeight = (std::max)(column.maxHeight, h);
+            column.top[i] = biomes[i].top;
+            column.filler[i] = biomes[i].filler;
+
+            Random::Stream rng(m_seed, cx * 16 + x, h, cz * 16 + z);
+            column.trees[i] = rng.nextFloat() < params.trees;
+
+            float plant = rng.nextFloat();
+            if (plant < params.grass)
+                column.plants[i] = Blocks::GrassPlant;
+            else if (plant < params.grass + params.flowers)
+                column.plants[i] = plant < params.grass + params.flowers * 0.5f ? Blocks::YellowFlower : Blocks::RedFlower;
+            else
+                column.plants[i] = Blocks::Air;
+        }
+    }
+}
+
+void TerrainGenerator::getHeights(int cx, int cz, float heights[CHUNK_SIZE * CHUNK_SIZE])
 {
-    double val = m_lowNoise.perlin3(x, z, 0.31415) + m_highNoise.perlin3(x, z, 0.271828) + 50;
-    if (val < 0)
-        val = 50;
-    if (val > 256)
-        val = 255;
-    return val;
+    m_graph.evaluate2D(m_height, cx * 16, cz * 16, heights);
 }
\ No newline at end of file
@@ -1,22 +1,47 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
+#include "biomemap.h"
 #include "chunk.h"
-#include "perlin.h"
+#include "columncache.h"
+#include "noisegraph.h"
+#include "structurebuffer.h"
 
 class TerrainGenerator
 {
 public:
-    TerrainGenerator();
+    enum Classification
+    {
+        Generate,
+        Sky,
+        Buried
+    };
+
+    TerrainGenerator(uint64_t seed);
 
+    Classification classify(const glm::ivec3 &coords);
     void generate(Chunk &c);
+    void generateColumn(std::vector<Chunk*> &chunks);
+    std::vector<StructureBuffer::Write> takeLateStructures();
+    void release(const glm::ivec3 &coords);
 
 private:
-    void putTree(Chunk &c, int x, int y, int z);
-    double getHeight(double x, double z);
-
-    Perlin m_highNoise;
-    Perlin m_lowNoise;
-    Perlin m_trees;
-    Perlin m_flowers;
-    Perlin m_grass;
+    void fillSection(Chunk &c, const ColumnData &column);
+    bool carveSection(const glm::ivec3 &coords, const ColumnData &column, std::vector<float> &carve);
+    void putTree(Chunk &c, int x, int y, int z, std::vector<StructureBuffer::Write> &overflow);
+    void postOverflow(std::vector<StructureBuffer::Write> &overflow);
+    void applyStructures(Chunk &c);
+    void getHeights(int cx, int cz, float heights[CHUNK_SIZE * CHUNK_SIZE]);
+    void fillColumn(int cx, int cz, ColumnData &column);
+
+    NoiseGraph m_graph;
+    NoiseGraph::Program m_height;
+    NoiseGraph::Program m_carve;
+
+    BiomeMap m_biomes;
+    ColumnCache m_columns;
+    StructureBuffer m_structures;
+    uint64_t m_seed;
 };
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "threadlanes.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+
+#include "topology.h"
+
+static const char *laneNames[ThreadLanes::LANE_AMOUNT] = { "interactive", "bulk", "io" };
+static const char *workNames[ThreadLanes::WORK_AMOUNT] = { "generate", "stream", "update", "edit", "save" };
+
+ThreadLanes::Settings ThreadLanes::defaults()
+{
+    std::vector<uint64_t> cores = Topology::getCores();
+    int workers = 0;
+    for (size_t i = cores.size() > 1 ? 1 : 0; i < cores.size(); i++)
+        workers += std::popcount(cores[i]);
+
+    // interactive work comes in small bursts, it shares the cores with bulk work but at a better nice value
+    int interactive = std::max(workers / 4, 1);
+    int bulk = std::max(workers - interactive, 1);
+
+    Settings settings;
+    settings.reserveMain = true;
+    settings.lanes[Interactive] = { interactive, 0, 0 };
+    settings.lanes[Bulk] = { bulk, 0, 5 };
+    // mostly blocked on the disk
+    settings.lanes[Io] = { 2, 0, 0 };
+    settings.routes[Generate] = Bulk;
+    settings.routes[Stream] = Bulk;
+    settings.routes[Update] = Interactive;
+    settings.routes[Edit] = Interactive;
+    settings.routes[Save] = Io;
+    return settings;
+}
+
+bool ThreadLanes::parseLane(const char *name, Lane &lane)
+{
+    for (int i = 0; i < LANE_AMOUNT; i++)
+    {
+        if (strcmp(name, laneNames[i]) == 0)
+        {
+            lane = static_cast<Lane>(i);
+            return true;
+        }
+    }
+
+    std::cout << "error: unknown lane " << name << std::endl;
+    return false;
+}
+
+bool ThreadLanes::parseWork(const char *name, Work &work)
+{
+    for (int i = 0; i < WORK_AMOUNT; i++)
+    {
+        if (strcmp(name, workNames[i]) == 0)
+        {
+            work = static_cast<Work>(i);
+            return true;
+        }
+    }
+
+    std::cout << "error: unknown work " << name << std::endl;
+    return false;
+}
+
+ThreadLanes::ThreadLanes(const Settings &settings) : m_settings(settings), m_workerMask(0)
+{
+    std::vector<uint64_t> cores = Topology::getCores();
+    bool reserve = settings.reserveMain && cores.size() > 1;
+    for (size_t i = reserve ? 1 : 0; i < cores.size(); i++)
+        m_workerMask |= cores[i];
+
+    if (reserve && !Topology::setAffinity(cores[0]))
+        std::cout << "error: can't reserve a core for the main thread" << std::endl;
+
+    // every lane can grow to all the worker cores at runtime, not the whole machine for each lane
+    int maxThreads = std::max(std::popcount(m_workerMask), 1);
+    for (int i = 0; i < LANE_AMOUNT; i++)
+    {
+        m_pools[i] = std::make_unique<ThreadPool>(settings.lanes[i].threads, maxThreads);
+        configure(static_cast<Lane>(i), settings.lanes[i]);
+    }
+}
+
+void ThreadLanes::configure(Lane lane, const Config &config)
+{
+    m_settings.lanes[lane] = config;
+
+    ThreadPool &pool = *m_pools[lane];
+    pool.setThreads(config.threads);
+    pool.setAffinity(config.affinity != 0 ? config.affinity : m_workerMask);
+    pool.setNice(config.nice);
+
+    std::cout << laneNames[lane] << " lane: " << pool.getWorkerAmount() << " threads, cpus " << std::hex <<
+        (config.affinity != 0 ? config.affinity : m_workerMask) << std::dec << ", nice " << config.nice << std::endl;
+}
+
+void ThreadLanes::reprioritize()
+{
+    for (auto &pool : m_pools)
+        pool->reprioritize();
+}
+
+int ThreadLanes::getJobsAmount()
+{
+    int jobs = 0;
+    for (auto &pool : m_pools)
+        jobs += pool->getJobsAmount();
+
+    return jobs;
+}
\ No newline at end of file
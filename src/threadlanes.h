@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "threadpool.h"
+
+// a pool per kind of work, so a burst of generation can't hold up a remesh the player is waiting for.
+// each lane has its own thread count, cpus and nice value, one physical core can be left to the main thread,
+// and which lane runs which work can change at runtime
+class ThreadLanes
+{
+public:
+    enum Lane
+    {
+        Interactive,
+        Bulk,
+        Io,
+        LANE_AMOUNT
+    };
+
+    enum Work
+    {
+        // new chunks, their terrain and then their first light and mesh
+        Generate,
+        Stream,
+        // loaded chunks that changed, and the ones the player just edited
+        Update,
+        Edit,
+        Save,
+        WORK_AMOUNT
+    };
+
+    struct Config
+    {
+        int threads;
+        // 0 for every core the lanes may use
+        uint64_t affinity;
+        int nice;
+    };
+
+    struct Settings
+    {
+        bool reserveMain;
+        Config lanes[LANE_AMOUNT];
+        Lane routes[WORK_AMOUNT];
+    };
+
+    // sized from the cpu topology, interactive and bulk together fill the cores left after the main thread
+    static Settings defaults();
+    static bool parseLane(const char *name, Lane &lane);
+    static bool parseWork(const char *name, Work &work);
+
+    // pins the calling thread to the reserved core when there is one
+    ThreadLanes(const Settings &settings);
+
+    ThreadPool &get(Lane lane) { return *m_pools[lane]; };
+    ThreadPool &get(Work work) { return *m_pools[m_settings.routes[work]]; };
+    const Settings &getSettings() const { return m_settings; };
+
+    void configure(Lane lane, const Config &config);
+    void setRoute(Work work, Lane lane) { m_settings.routes[work] = lane; };
+    void reprioritize();
+    int getJobsAmount();
+
+private:
+    Settings m_settings;
+    uint64_t m_workerMask;
+    std::unique_ptr<ThreadPool> m_pools[LANE_AMOUNT];
+};
\ No newline at end of file
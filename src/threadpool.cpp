@@ -1,42 +1,191 @@
 #include "threadpool.h"
 
+#include <algorithm>
 #include <iostream>
 #include <mutex>
 
-ThreadPool::ThreadPool() : m_stop(false), m_jobsPending(0)
+#include "topology.h"
+
+static thread_local ThreadPool *t_pool = nullptr;
+static thread_local int t_worker = -1;
+
+static uint32_t xorshift(uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+ThreadPool::ThreadPool(int threads, int maxThreads) : m_prioritizedSize(0), m_jobsPending(0), m_queued(0), m_parked(0),
+    m_stop(false), m_active(std::max(threads, 1)), m_affinity(0), m_nice(0), m_settings(0)
 {
-    int nThreads = std::thread::hardware_concurrency();
+    // every thread is started up front so the worker array never changes under a thief
+    int nThreads = std::max(m_active.load(), maxThreads);
+    for (int i = 0; i < nThreads; i++)
+    {
+        m_workers.push_back(std::make_unique<Worker>());
+        m_workers.back()->rng = 0x9E3779B9u * (i + 1);
+    }
+
+    // every deque exists before any worker can try to steal from it
     for (int i = 0; i < nThreads; i++)
     {
-        m_workers.push_back(std::thread(&ThreadPool::getJob, this));
+        m_workers[i]->thread = std::thread(&ThreadPool::work, this, i);
     }
 }
 
 ThreadPool::~ThreadPool()
 {
-    m_stop = true;
-    m_cond.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(m_parkMutex);
+        m_stop = true;
+    }
+    m_parkCond.notify_all();
+
+    for (auto &worker : m_workers)
+    {
+        worker->thread.join();
+    }
+
+    // jobs still queued at shutdown are dropped, same as before
+    for (auto &worker : m_workers)
+    {
+        while (Task *task = worker->deque.pop())
+            delete task;
+    }
+}
+
+void ThreadPool::addJob(Job job)
+{
+    m_jobsPending++;
 
-    for (int i = 0; i < m_workers.size(); i++)
+    if (t_pool == this)
     {
-        m_workers[i].join();
-    }  
+        pushLocal(job);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_injectMutex);
+        m_injected.push_back(std::move(job));
+    }
+
+    m_queued++;
+    wake(1);
 }
 
-void ThreadPool::addJob(std::function<void()> job)
+std::shared_ptr<ThreadPool::Handle> ThreadPool::addJob(Job job, int priority)
 {
+    auto handle = std::make_shared<Handle>(priority);
     m_jobsPending++;
-    std::unique_lock<std::mutex> lock(m_mutex);
-    m_queue.push(job);
-    lock.unlock();
-    m_cond.notify_one();
+
+    {
+        std::lock_guard<std::mutex> lock(m_priorityMutex);
+        m_prioritized.push_back({ { std::move(job), handle }, priority });
+        std::push_heap(m_prioritized.begin(), m_prioritized.end());
+        m_prioritizedSize = m_prioritized.size();
+    }
+
+    m_queued++;
+    wake(1);
+    return handle;
+}
+
+void ThreadPool::addJobs(std::vector<Job> &jobs)
+{
+    if (jobs.empty())
+        return;
+
+    m_jobsPending += static_cast<int>(jobs.size());
+
+    if (t_pool == this)
+    {
+        for (Job &job : jobs)
+            pushLocal(job);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_injectMutex);
+        for (Job &job : jobs)
+            m_injected.push_back(std::move(job));
+    }
+
+    m_queued += static_cast<int>(jobs.size());
+    wake(jobs.size());
+    jobs.clear();
+}
+
+std::vector<std::shared_ptr<ThreadPool::Handle>> ThreadPool::addJobs(std::vector<Job> &jobs, const std::vector<int> &priorities)
+{
+    std::vector<std::shared_ptr<Handle>> handles;
+    if (jobs.empty())
+        return handles;
+
+    handles.reserve(jobs.size());
+    for (int priority : priorities)
+        handles.push_back(std::make_shared<Handle>(priority));
+
+    m_jobsPending += static_cast<int>(jobs.size());
+
+    {
+        std::lock_guard<std::mutex> lock(m_priorityMutex);
+        for (size_t i = 0; i < jobs.size(); i++)
+        {
+            m_prioritized.push_back({ { std::move(jobs[i]), handles[i] }, priorities[i] });
+            std::push_heap(m_prioritized.begin(), m_prioritized.end());
+        }
+        m_prioritizedSize = m_prioritized.size();
+    }
+
+    m_queued += static_cast<int>(jobs.size());
+    wake(jobs.size());
+    jobs.clear();
+    return handles;
+}
+
+bool ThreadPool::cancel(Handle &handle)
+{
+    int queued = Handle::Queued;
+    if (!handle.m_state.compare_exchange_strong(queued, Handle::Cancelled))
+        return false;
+
+    // the heap entry stays until it is popped or the next reprioritize drops it
+    m_queued--;
+    finish();
+    return true;
+}
+
+void ThreadPool::reprioritize()
+{
+    std::lock_guard<std::mutex> lock(m_priorityMutex);
+    auto cancelled = [](const Prioritized &entry) -> bool
+    {
+        return entry.task.handle->m_state == Handle::Cancelled;
+    };
+    m_prioritized.erase(std::remove_if(m_prioritized.begin(), m_prioritized.end(), cancelled), m_prioritized.end());
+
+    for (auto &entry : m_prioritized)
+        entry.priority = entry.task.handle->m_priority;
+
+    std::make_heap(m_prioritized.begin(), m_prioritized.end());
+    m_prioritizedSize = m_prioritized.size();
 }
 
 void ThreadPool::waitUntilCompleted()
 {
-    if (m_jobsPending <= 0) return;
-    std::unique_lock<std::mutex> lock(m_finishMutex);
-    m_finishCond.wait(lock);
+    uint32_t rng = 0x85EBCA6Bu;
+    Task task;
+    while (m_jobsPending > 0)
+    {
+        if (findTask(-1, rng, task))
+        {
+            run(task);
+            continue;
+        }
+
+        // whatever is left is already running, sleep until it finishes or spawns more work
+        park([this] { return m_jobsPending <= 0 || m_queued > 0; });
+    }
 }
 
 int ThreadPool::getJobsAmount()
@@ -46,28 +195,209 @@ int ThreadPool::getJobsAmount()
 
 int ThreadPool::getWorkerAmount()
 {
-    return m_workers.size();
+    return m_active;
+}
+
+void ThreadPool::setThreads(int threads)
+{
+    m_active = std::clamp(threads, 1, static_cast<int>(m_workers.size()));
+    changeSettings();
 }
 
-void ThreadPool::getJob()
+void ThreadPool::setAffinity(uint64_t mask)
+{
+    m_affinity = mask;
+    changeSettings();
+}
+
+void ThreadPool::setNice(int nice)
+{
+    m_nice = nice;
+    changeSettings();
+}
+
+void ThreadPool::changeSettings()
 {
-    while (true)
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
+        std::lock_guard<std::mutex> lock(m_parkMutex);
+        m_settings++;
+    }
+    m_parkCond.notify_all();
+}
+
+void ThreadPool::work(int index)
+{
+    t_pool = this;
+    t_worker = index;
+    uint32_t &rng = m_workers[index]->rng;
+    Task task;
+    int applied = -1;
+
+    while (!m_stop)
+    {
+        if (m_settings != applied)
+        {
+            applied = m_settings;
+            if (m_affinity != 0)
+                Topology::setAffinity(m_affinity);
+            Topology::setNice(m_nice);
+        }
+
+        if (index >= m_active)
+        {
+            park([this, index, applied] { return index < m_active || m_stop || m_settings != applied; });
+            continue;
+        }
 
-        m_cond.wait(lock, [this] {return !m_queue.empty() || m_stop; });
+        bool found = false;
+        for (int i = 0; i < STEAL_ATTEMPTS && !found && !m_stop; i++)
+        {
+            found = findTask(index, rng, task);
+            if (!found)
+                std::this_thread::yield();
+        }
 
-        if (m_stop)
-            return;
+        if (found)
+            run(task);
+        else
+            park([this, applied] { return m_queued > 0 || m_stop || m_settings != applied; });
+    }
+}
 
-        std::function<void()> job = m_queue.front();
-        m_queue.pop();
-        lock.unlock();
+bool ThreadPool::findTask(int index, uint32_t &rng, Task &task)
+{
+    Task *node = nullptr;
+    if (index >= 0)
+        node = m_workers[index]->deque.pop();
 
-        job();
-        if (--m_jobsPending == 0)
+    // nothing queued anywhere, skip the locks and the victims
+    if (node == nullptr && m_queued <= 0)
+        return false;
+
+    bool found = node != nullptr || takePrioritized(task) || takeInjected(task);
+
+    int n = m_workers.size();
+    for (int i = 0, start = xorshift(rng) % n; i < n && !found; i++)
+    {
+        int victim = (start + i) % n;
+        if (victim != index)
         {
-            m_finishCond.notify_one();
+            node = m_workers[victim]->deque.steal();
+            found = node != nullptr;
         }
     }
+
+    if (node != nullptr)
+    {
+        task = std::move(*node);
+        if (index >= 0 && m_workers[index]->spare.size() < MAX_SPARE_TASKS)
+            m_workers[index]->spare.emplace_back(node);
+        else
+            delete node;
+    }
+
+    if (found)
+        m_queued--;
+
+    return found;
+}
+
+bool ThreadPool::takeInjected(Task &task)
+{
+    std::lock_guard<std::mutex> lock(m_injectMutex);
+    if (m_injected.empty())
+        return false;
+
+    task.job = std::move(m_injected.front());
+    task.handle.reset();
+    m_injected.pop_front();
+    return true;
+}
+
+bool ThreadPool::takePrioritized(Task &task)
+{
+    if (m_prioritizedSize == 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_priorityMutex);
+    while (!m_prioritized.empty())
+    {
+        std::pop_heap(m_prioritized.begin(), m_prioritized.end());
+        Prioritized &entry = m_prioritized.back();
+
+        int queued = Handle::Queued;
+        bool claimed = entry.task.handle->m_state.compare_exchange_strong(queued, Handle::Running);
+        if (claimed)
+            task = std::move(entry.task);
+
+        m_prioritized.pop_back();
+        m_prioritizedSize = m_prioritized.size();
+        if (claimed)
+            return true;
+    }
+
+    return false;
+}
+
+ThreadPool::Task *ThreadPool::newTask(Worker &worker)
+{
+    if (worker.spare.empty())
+        return new Task();
+
+    Task *task = worker.spare.back().release();
+    worker.spare.pop_back();
+    return task;
+}
+
+void ThreadPool::pushLocal(Job &job)
+{
+    Worker &worker = *m_workers[t_worker];
+    Task *task = newTask(worker);
+    task->job = std::move(job);
+    task->handle.reset();
+    worker.deque.push(task);
+}
+
+void ThreadPool::wake(size_t jobs)
+{
+    if (m_parked == 0)
+        return;
+
+    // a single notify could land on a sleeping inactive worker
+    std::lock_guard<std::mutex> lock(m_parkMutex);
+    if (jobs > 1 || m_active < static_cast<int>(m_workers.size()))
+        m_parkCond.notify_all();
+    else
+        m_parkCond.notify_one();
+}
+
+void ThreadPool::run(Task &task)
+{
+    task.job();
+    task.job = Job();
+    if (task.handle)
+    {
+        task.handle->m_state = Handle::Done;
+        task.handle.reset();
+    }
+
+    finish();
+}
+
+void ThreadPool::finish()
+{
+    if (--m_jobsPending == 0)
+    {
+        std::lock_guard<std::mutex> lock(m_parkMutex);
+        m_parkCond.notify_all();
+    }
+}
+
+void ThreadPool::park(const std::function<bool()> &wake)
+{
+    // m_parked goes up before the condition is checked, so a job added after the check always notifies
+    std::unique_lock<std::mutex> lock(m_parkMutex);
+    m_parked++;
+    m_parkCond.wait(lock, wake);
+    m_parked--;
 }
\ No newline at end of file
@@ -2,31 +2,130 @@
 
 #include <atomic>
 #include <condition_variable>
-#include <queue>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
+#include "job.h"
+#include "workdeque.h"
+
+// work stealing pool, jobs added from a worker go on its own deque and everything else goes through the
+// injection queue, idle workers steal from a random victim before parking. prioritized jobs wait in a heap
+// that is ordered again on reprioritize() and run before anything not already on a worker's deque
 class ThreadPool
 {
 public:
-    ThreadPool();
+    class Handle
+    {
+    public:
+        Handle(int priority) : m_priority(priority), m_state(Queued) {};
+
+        // lower runs first, takes effect on the next reprioritize()
+        void setPriority(int priority) { m_priority = priority; };
+        int getPriority() const { return m_priority; };
+        bool isFinished() const { return m_state == Done || m_state == Cancelled; };
+        bool isCancelled() const { return m_state == Cancelled; };
+
+    private:
+        friend class ThreadPool;
+
+        enum State
+        {
+            Queued,
+            Running,
+            Done,
+            Cancelled
+        };
+
+        std::atomic<int> m_priority;
+        std::atomic<int> m_state;
+    };
+
+    // threads can later go up to maxThreads, or to the starting amount if that is larger
+    ThreadPool(int threads = std::thread::hardware_concurrency(), int maxThreads = 0);
     ~ThreadPool();
 
-    void addJob(std::function<void()> job);
+    void addJob(Job job);
+    std::shared_ptr<Handle> addJob(Job job, int priority);
+    // the whole batch goes in under one lock and wakes the workers once, the jobs are moved out
+    void addJobs(std::vector<Job> &jobs);
+    std::vector<std::shared_ptr<Handle>> addJobs(std::vector<Job> &jobs, const std::vector<int> &priorities);
+    // false once the job has started
+    bool cancel(Handle &handle);
+    void reprioritize();
+    // the calling thread runs queued jobs until every job has finished
     void waitUntilCompleted();
     int getJobsAmount();
     int getWorkerAmount();
 
+    // workers above the amount sleep once their current job is done, what they queued can still be stolen
+    void setThreads(int threads);
+    // workers apply these to themselves before their next job, a mask of 0 leaves the affinity alone
+    void setAffinity(uint64_t mask);
+    void setNice(int nice);
+
 private:
-    void getJob();
+    static const int STEAL_ATTEMPTS = 64;
+    static const size_t MAX_SPARE_TASKS = 256;
+
+    struct Task
+    {
+        Job job;
+        std::shared_ptr<Handle> handle;
+    };
 
-    std::vector<std::thread> m_workers;
-    std::queue<std::function<void()>> m_queue;
-    std::mutex m_mutex;
-    std::condition_variable m_cond;
+    struct Prioritized
+    {
+        Task task;
+        int priority;
+
+        bool operator<(const Prioritized &other) const { return priority > other.priority; };
+    };
+
+    struct Worker
+    {
+        WorkDeque<Task> deque;
+        // deque entries are recycled by whichever worker ran them
+        std::vector<std::unique_ptr<Task>> spare;
+        std::thread thread;
+        uint32_t rng;
+    };
+
+    void work(int index);
+    bool findTask(int index, uint32_t &rng, Task &task);
+    bool takeInjected(Task &task);
+    bool takePrioritized(Task &task);
+    Task *newTask(Worker &worker);
+    void pushLocal(Job &job);
+    void wake(size_t jobs);
+    void finish();
+    void run(Task &task);
+    void park(const std::function<bool()> &wake);
+    void changeSettings();
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    std::deque<Job> m_injected;
+    std::mutex m_injectMutex;
+
+    std::vector<Prioritized> m_prioritized;
+    std::atomic<int> m_prioritizedSize;
+    std::mutex m_priorityMutex;
 
     std::atomic<int> m_jobsPending;
-    std::mutex m_finishMutex;
-    std::condition_variable m_finishCond;
-    bool m_stop;
+    std::atomic<int> m_queued;
+    std::atomic<int> m_parked;
+    std::mutex m_parkMutex;
+    std::condition_variable m_parkCond;
+    std::atomic<bool> m_stop;
+
+    std::atomic<int> m_active;
+    std::atomic<uint64_t> m_affinity;
+    std::atomic<int> m_nice;
+    // bumped on every change, a worker compares it to the last one it applied
+    std::atomic<int> m_settings;
 };
\ No newline at end of file
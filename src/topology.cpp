@@ -0,0 +1,112 @@
+#include "topology.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Topology
+{
+    static const int MAX_CPUS = 64;
+
+    // sysfs cpu lists look like "0-3,8"
+    static uint64_t parseList(const std::string &list)
+    {
+        uint64_t mask = 0;
+        std::stringstream stream(list);
+        std::string range;
+        while (std::getline(stream, range, ','))
+        {
+            size_t dash = range.find('-');
+            int first = std::atoi(range.c_str());
+            int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+            for (int cpu = first; cpu <= last && cpu < MAX_CPUS; cpu++)
+                mask |= 1ull << cpu;
+        }
+
+        return mask;
+    }
+
+    static uint64_t getAllowed()
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        {
+            uint64_t mask = 0;
+            for (int cpu = 0; cpu < MAX_CPUS; cpu++)
+            {
+                if (CPU_ISSET(cpu, &set))
+                    mask |= 1ull << cpu;
+            }
+
+            if (mask != 0)
+                return mask;
+        }
+#endif
+        int n = std::max(1u, std::min(std::thread::hardware_concurrency(), static_cast<unsigned>(MAX_CPUS)));
+        return n == MAX_CPUS ? ~0ull : (1ull << n) - 1;
+    }
+
+    std::vector<uint64_t> getCores()
+    {
+        uint64_t allowed = getAllowed();
+        uint64_t seen = 0;
+        std::vector<uint64_t> cores;
+        for (int cpu = 0; cpu < MAX_CPUS; cpu++)
+        {
+            uint64_t bit = 1ull << cpu;
+            if (!(allowed & bit) || (seen & bit))
+                continue;
+
+            // without sysfs every cpu counts as its own core
+            uint64_t siblings = bit;
+            std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list");
+            std::string list;
+            if (file && std::getline(file, list))
+                siblings = (parseList(list) & allowed) | bit;
+
+            seen |= siblings;
+            cores.push_back(siblings);
+        }
+
+        return cores;
+    }
+
+    bool setAffinity(uint64_t mask)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < MAX_CPUS; cpu++)
+        {
+            if (mask & (1ull << cpu))
+                CPU_SET(cpu, &set);
+        }
+
+        return mask != 0 && sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        return false;
+#endif
+    }
+
+    bool setNice(int nice)
+    {
+#ifdef __linux__
+        // linux keeps a nice value per thread, the thread id only ever names the caller
+        return setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), nice) == 0;
+#else
+        return false;
+#endif
+    }
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// cpu layout and per thread placement, cpus are bits of a 64 bit mask so only the first 64 are used
+namespace Topology
+{
+    // one mask per physical core holding its hyperthreads, only cpus this process may run on, in cpu order
+    std::vector<uint64_t> getCores();
+
+    // both only affect the calling thread and return false where the system refuses or doesn't support it,
+    // lowering nice below what the process started with usually needs privileges
+    bool setAffinity(uint64_t mask);
+    bool setNice(int nice);
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Chase-Lev deque, the owning thread pushes and pops at the bottom while any thread can steal from the top
+template<typename T>
+class WorkDeque
+{
+public:
+    WorkDeque(int64_t capacity = 256);
+
+    void push(T *item);
+    T *pop();
+    T *steal();
+    bool empty() const;
+
+private:
+    struct Array
+    {
+        Array(int64_t capacity) : capacity(capacity), mask(capacity - 1), items(new std::atomic<T*>[capacity]) {};
+
+        T *get(int64_t i) { return items[i & mask].load(std::memory_order_relaxed); };
+        void put(int64_t i, T *item) { items[i & mask].store(item, std::memory_order_relaxed); };
+
+        int64_t capacity;
+        int64_t mask;
+        std::unique_ptr<std::atomic<T*>[]> items;
+    };
+
+    Array *grow(Array *array, int64_t top, int64_t bottom);
+
+    std::atomic<int64_t> m_top;
+    std::atomic<int64_t> m_bottom;
+    std::atomic<Array*> m_array;
+    // thieves may still be reading an outgrown array, so they live as long as the deque
+    std::vector<std::unique_ptr<Array>> m_arrays;
+};
+
+template<typename T>
+WorkDeque<T>::WorkDeque(int64_t capacity) : m_top(0), m_bottom(0)
+{
+    m_arrays.push_back(std::make_unique<Array>(capacity));
+    m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+}
+
+template<typename T>
+void WorkDeque<T>::push(T *item)
+{
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    int64_t top = m_top.load(std::memory_order_acquire);
+    Array *array = m_array.load(std::memory_order_relaxed);
+
+    if (bottom - top > array->capacity - 1)
+        array = grow(array, top, bottom);
+
+    array->put(bottom, item);
+    m_bottom.store(bottom + 1, std::memory_order_release);
+}
+
+template<typename T>
+T *WorkDeque<T>::pop()
+{
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    Array *array = m_array.load(std::memory_order_relaxed);
+    m_bottom.store(bottom, std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_seq_cst);
+
+    if (top > bottom)
+    {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    T *item = array->get(bottom);
+    if (top == bottom)
+    {
+        // last item, race the thieves for it
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            item = nullptr;
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return item;
+}
+
+template<typename T>
+T *WorkDeque<T>::steal()
+{
+    int64_t top = m_top.load(std::memory_order_seq_cst);
+    int64_t bottom = m_bottom.load(std::memory_order_seq_cst);
+    if (top >= bottom)
+        return nullptr;
+
+    T *item = m_array.load(std::memory_order_acquire)->get(top);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+
+    return item;
+}
+
+template<typename T>
+bool WorkDeque<T>::empty() const
+{
+    return m_top.load(std::memory_order_relaxed) >= m_bottom.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+typename WorkDeque<T>::Array *WorkDeque<T>::grow(Array *array, int64_t top, int64_t bottom)
+{
+    m_arrays.push_back(std::make_unique<Array>(array->capacity * 2));
+    Array *grown = m_arrays.back().get();
+    for (int64_t i = top; i < bottom; i++)
+        grown->put(i, array->get(i));
+
+    m_array.store(grown, std::memory_order_release);
+    return grown;
+}
\ No newline at end of file